@@ -20,11 +20,32 @@
    THE SOFTWARE.
 */
 
+#include <direct/thread.h>
 #include <direct/util.h>
 #include <directfb.h>
 #include <directfb_strings.h>
 #include <directfb_util.h>
+#include <dirent.h>
+#include <errno.h>
+#ifdef HAVE_DLOPEN
+#include <dlfcn.h>
+#endif
+#include <limits.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <time.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
+#include "df_dok_plugin.h"
+#include "df_dok_record.h"
 #include "util.h"
 
 #ifdef USE_FONT_HEADERS
@@ -74,11 +95,20 @@ static IDirectFBSurface *image32    = NULL;
 static IDirectFBSurface *image32a   = NULL;
 static IDirectFBSurface *image8a    = NULL;
 
+/* source color key of the colorkeyed image */
+static const DFBColor colorkey = { 0xFF, 0x06, 0x18, 0xF4 };
+
 /* "Press any key to proceed..." intro screen */
 static IDirectFBSurface *intro = NULL;
 
-/* primary subsurface */
-static IDirectFBSurface *dest = NULL;
+/* primary subsurface, each worker thread of the scaling benchmark has its own offscreen surface */
+static __thread IDirectFBSurface *dest = NULL;
+
+/* set in worker threads of the scaling benchmark */
+static __thread bool bench_worker = false;
+
+/* acceleration seen by a worker thread, merged into the demo after it has finished */
+static __thread bool bench_accelerated = false;
 
 /* screen width and height (possibly less the height of the status bar) */
 static int SW, SH;
@@ -90,12 +120,17 @@ static int ui_fontheight;
 
 /* command line options */
 static int                    DEMOTIME       = 3000; /* milliseconds */
+static int                    SAMPLETIME     = 3000; /* milliseconds, a tenth of DEMOTIME when converging */
 static int                    ITERATIONS     = 1;
+static int                    WARMUP         = -1;
+static int                    MAXTIME        = 60000; /* milliseconds */
+static float                  converge       = 0;     /* percent */
 static int                    SX             = 256;
 static int                    SY             = 256;
 static DFBSurfacePixelFormat  pixelformat    = DSPF_UNKNOWN;
 static int                    do_system      = 0;
 static int                    do_dump        = 0;
+static int                    dump_format    = 0;     /* DumpFormat */
 static int                    do_wait        = 0;
 static int                    do_noaccel     = 0;
 static int                    accel_only     = 0;
@@ -108,7 +143,36 @@ static int                    do_all_demos   = 0;
 static int                    output_csv     = 0;
 static int                    run_fullscreen = 0;
 static int                    with_intro     = 0;
-static const char            *filename       = NULL;
+static char                 **image_files    = NULL;
+static int                    num_image_files = 0;
+static int                    load_fresh     = 0;
+static int                    do_perf        = 0;
+static int                    show_drain     = 0;
+static int                    soak_minutes   = 0;
+static int                    soak_interval  = 60;    /* seconds */
+static const char            *trace_filename = NULL;
+static int                    trace_calls    = 0;
+static long long              cold_budget    = 0;     /* bytes */
+#ifdef DF_DOK_PLUGINDIR
+static const char            *plugin_dir     = DF_DOK_PLUGINDIR;
+#else
+static const char            *plugin_dir     = NULL;
+#endif
+static const char            *json_filename  = NULL;
+static int                    latency_batch  = 0;
+static int                    num_threads    = 0;
+static const char            *verify_filename = NULL;
+static int                    verify_ops     = 200;
+static int                    format_sweep   = 0;
+static const char            *sweep_formats  = NULL;
+static int                    size_sweep     = 0;
+static int                    align_sweep    = 0;     /* 1 for destination, 2 for source offsets */
+static int                    pitch_pad      = 0;     /* bytes */
+static int                    sweep_min      = 8;
+static int                    sweep_max      = 0;
+static int                    batch_size     = 10;
+static int                    ui_width       = 0;     /* target resolution of the UI frame, 0 for the screen */
+static int                    ui_height      = 0;
 
 /* benchmarks */
 static unsigned long long draw_string            ( long long t );
@@ -119,6 +183,7 @@ static unsigned long long fill_rects             ( long long t );
 static unsigned long long fill_rects_blend       ( long long t );
 static unsigned long long fill_triangle          ( long long t );
 static unsigned long long fill_triangle_blend    ( long long t );
+static unsigned long long fill_triangles         ( long long t );
 static unsigned long long draw_rect              ( long long t );
 static unsigned long long draw_rect_blend        ( long long t );
 static unsigned long long draw_lines             ( long long t );
@@ -128,6 +193,14 @@ static unsigned long long fill_spans_blend       ( long long t );
 static unsigned long long fill_traps             ( long long t );
 static unsigned long long blit                   ( long long t );
 static unsigned long long blit180                ( long long t );
+static unsigned long long blit90                 ( long long t );
+static unsigned long long blit90_blend           ( long long t );
+static unsigned long long blit270                ( long long t );
+static unsigned long long blit270_blend          ( long long t );
+static unsigned long long blit_flip_h            ( long long t );
+static unsigned long long blit_flip_h_blend      ( long long t );
+static unsigned long long blit_flip_v            ( long long t );
+static unsigned long long blit_flip_v_blend      ( long long t );
 static unsigned long long blit_colorkeyed        ( long long t );
 static unsigned long long blit_dst_colorkeyed    ( long long t );
 static unsigned long long blit_convert           ( long long t );
@@ -137,9 +210,66 @@ static unsigned long long blit_blend             ( long long t );
 static unsigned long long blit_blend_colorize    ( long long t );
 static unsigned long long blit_srcover           ( long long t );
 static unsigned long long blit_srcover_pre       ( long long t );
+static unsigned long long batch_blit             ( long long t );
+static unsigned long long tile_blit              ( long long t );
+static unsigned long long blit_subrect           ( long long t );
+static unsigned long long blit_odd_width         ( long long t );
 static unsigned long long stretch_blit           ( long long t );
 static unsigned long long stretch_blit_colorkeyed( long long t );
+static unsigned long long batch_stretch_blit     ( long long t );
+static unsigned long long texture_triangles      ( long long t );
+static unsigned long long ui_frame               ( long long t );
+static unsigned long long state_color            ( long long t );
+static unsigned long long state_drawing_flags    ( long long t );
+static unsigned long long state_blitting_flags   ( long long t );
+static unsigned long long state_porter_duff      ( long long t );
+static unsigned long long state_src_colorkey     ( long long t );
+static unsigned long long call_fill              ( long long t );
+static unsigned long long call_blit              ( long long t );
+static unsigned long long call_fill_blit         ( long long t );
+static unsigned long long call_alternating       ( long long t );
+static unsigned long long blit_porter_duff       ( long long t );
+static unsigned long long stretch_ratio          ( long long t );
+static unsigned long long blit_yuv               ( long long t );
 static unsigned long long load_image             ( long long t );
+static unsigned long long replay_trace           ( long long t );
+
+typedef struct {
+     unsigned long long   ops;        /* raw count returned by the benchmark function */
+     long long            elapsed;    /* milliseconds */
+     int                  load;       /* CPU load in per mille */
+     long long            submit;     /* nanoseconds until all operations were issued */
+     long long            drain;      /* nanoseconds of waiting for the completion of the issued operations */
+     int                  drain_idle; /* CPU idle time during the drain in per mille */
+} DemoSample;
+
+typedef struct {
+     double               min;
+     double               median;
+     double               mean;
+     double               stddev;
+     double               p95;
+     double               ci95;       /* half width of the 95% confidence interval of the mean */
+} DemoStats;
+
+/* log-bucketed latency histogram, each power of two is split into LATENCY_SUB_BUCKETS linear buckets */
+#define LATENCY_SUB_BITS    5
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_MAX_BITS    44
+#define LATENCY_BUCKETS     ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 2) * LATENCY_SUB_BUCKETS)
+
+typedef struct {
+     unsigned long long   count;
+     unsigned long long   max;        /* nanoseconds */
+     unsigned int         buckets[LATENCY_BUCKETS];
+} LatencyHistogram;
+
+typedef enum {
+     VERIFY_NONE,
+     VERIFY_OK,
+     VERIFY_FAILED,
+     VERIFY_RECORDED
+} VerifyResult;
 
 typedef struct {
      char                 desc[128];
@@ -154,9 +284,17 @@ typedef struct {
      unsigned long long (*func)( long long );
      int                  load;
      long                 duration;
+     DemoSample          *samples;
+     int                  num_samples;
+     LatencyHistogram    *latency;
+     VerifyResult         verify;
+     const DFDokBenchmark *plugin;
+     void                *plugin_data;
+     int                  param;      /* parameter of generated demos */
+     IDirectFBSurface    *source;     /* created by the setup of generated demos */
 } Demo;
 
-static Demo demos[] = {
+static Demo builtin_demos[] = {
      { "Anti-aliased Text",
        "This is the DirectFB benchmarking tool, let's start with some text!",
        "Anti-aliased Text", "draw-string", true,
@@ -189,6 +327,10 @@ static Demo demos[] = {
        "What about alpha blended triangles?",
        "Alpha Blended Triangle Filling", "fill-triangle-blend", true,
        0, 0, 0, "MPixel/sec", fill_triangle_blend },
+     { "Fill Triangles [n]",
+       "Let's fill a whole batch of triangles at once!",
+       "Batched Triangle Filling", "fill-triangles", false,
+       0, 0, 0, "MPixel/sec", fill_triangles },
      { "Draw Rectangle",
        "Now pass over to non filled rectangles!",
        "Rectangle Outlines", "draw-rect", true,
@@ -225,6 +367,38 @@ static Demo demos[] = {
        "Rotation?",
        "Rotated BitBlt", "blit180", true,
        0, 0, 0, "MPixel/sec", blit180 },
+     { "Blit 90",
+       "Rotation by 90 degrees!",
+       "Rotated BitBlt 90", "blit90", false,
+       0, 0, 0, "MPixel/sec", blit90 },
+     { "Blit 90 (blend)",
+       "Rotation by 90 degrees!",
+       "Rotated BitBlt 90 with alpha blending", "blit90-blend", false,
+       0, 0, 0, "MPixel/sec", blit90_blend },
+     { "Blit 270",
+       "Rotation by 270 degrees!",
+       "Rotated BitBlt 270", "blit270", false,
+       0, 0, 0, "MPixel/sec", blit270 },
+     { "Blit 270 (blend)",
+       "Rotation by 270 degrees!",
+       "Rotated BitBlt 270 with alpha blending", "blit270-blend", false,
+       0, 0, 0, "MPixel/sec", blit270_blend },
+     { "Blit flipped horizontally",
+       "Mirroring!",
+       "Horizontally flipped BitBlt", "blit-flip-h", false,
+       0, 0, 0, "MPixel/sec", blit_flip_h },
+     { "Blit flipped horizontally (blend)",
+       "Mirroring!",
+       "Horizontally flipped BitBlt with alpha blending", "blit-flip-h-blend", false,
+       0, 0, 0, "MPixel/sec", blit_flip_h_blend },
+     { "Blit flipped vertically",
+       "Mirroring!",
+       "Vertically flipped BitBlt", "blit-flip-v", false,
+       0, 0, 0, "MPixel/sec", blit_flip_v },
+     { "Blit flipped vertically (blend)",
+       "Mirroring!",
+       "Vertically flipped BitBlt with alpha blending", "blit-flip-v-blend", false,
+       0, 0, 0, "MPixel/sec", blit_flip_v_blend },
      { "Blit colorkeyed",
        "Color keying would be nice...",
        "BitBlt with Color Keying", "blit-colorkeyed", true,
@@ -261,6 +435,22 @@ static Demo demos[] = {
        "With alpha blending based on alpha entries",
        "BitBlt SrcOver premultiply", "blit-srcover-pre", true,
        0, 0, 0, "MPixel/sec", blit_srcover_pre },
+     { "Batch Blit [n]",
+       "Many blits with a single call...",
+       "Batched BitBlt", "batch-blit", false,
+       0, 0, 0, "MPixel/sec", batch_blit },
+     { "Tile Blit",
+       "Tiling the whole area...",
+       "Tiled BitBlt", "tile-blit", false,
+       0, 0, 0, "MPixel/sec", tile_blit },
+     { "Blit sub-rectangle",
+       "Blitting parts of a larger image!",
+       "BitBlt from source offsets", "blit-subrect", false,
+       0, 0, 0, "MPixel/sec", blit_subrect },
+     { "Blit odd widths",
+       "Blitting odd widths!",
+       "BitBlt with odd widths", "blit-odd-width", false,
+       0, 0, 0, "MPixel/sec", blit_odd_width },
      { "Stretch Blit",
        "Stretching!",
        "Stretch Blit", "stretch-blit", true,
@@ -269,17 +459,105 @@ static Demo demos[] = {
        "Stretching with color keying!",
        "Stretch Blit with color keying", "stretch-blit-colorkeyed", true,
        0, 0, 0, "MPixel/sec", stretch_blit_colorkeyed },
+     { "Batch Stretch Blit [n]",
+       "Many stretched blits with a single call!",
+       "Batched Stretch Blit", "batch-stretch-blit", false,
+       0, 0, 0, "MPixel/sec", batch_stretch_blit },
+     { "Texture Triangles [n]",
+       "Textured triangles like in 3D!",
+       "Texture Mapped Triangles", "texture-triangles", false,
+       0, 0, 0, "MPixel/sec", texture_triangles },
+     { "UI Frame",
+       "Composing a user interface!",
+       "UI Frame Composition", "ui-frame", false,
+       0, 0, 0, "Frames/sec", ui_frame },
+     { "SetColor",
+       "Measuring the cost of state changes!",
+       "State change SetColor", "state-color", false,
+       0, 0, 0, "MCalls/sec", state_color },
+     { "SetDrawingFlags",
+       "Measuring the cost of state changes!",
+       "State change SetDrawingFlags", "state-drawing-flags", false,
+       0, 0, 0, "MCalls/sec", state_drawing_flags },
+     { "SetBlittingFlags",
+       "Measuring the cost of state changes!",
+       "State change SetBlittingFlags", "state-blitting-flags", false,
+       0, 0, 0, "MCalls/sec", state_blitting_flags },
+     { "SetPorterDuff",
+       "Measuring the cost of state changes!",
+       "State change SetPorterDuff", "state-porter-duff", false,
+       0, 0, 0, "MCalls/sec", state_porter_duff },
+     { "SetSrcColorKey",
+       "Measuring the cost of state changes!",
+       "State change SetSrcColorKey", "state-src-colorkey", false,
+       0, 0, 0, "MCalls/sec", state_src_colorkey },
+     { "Fill Rectangle 1x1",
+       "Measuring the overhead per call!",
+       "Call overhead FillRectangle", "call-fill", false,
+       0, 0, 0, "MCalls/sec", call_fill },
+     { "Blit 1x1",
+       "Measuring the overhead per call!",
+       "Call overhead Blit", "call-blit", false,
+       0, 0, 0, "MCalls/sec", call_blit },
+     { "Fill/Blit 1x1 interleaved",
+       "Switching between drawing and blitting!",
+       "Interleaved FillRectangle and Blit", "call-fill-blit", false,
+       0, 0, 0, "MCalls/sec", call_fill_blit },
+     { "Fill/Blit 1x1 alternating state",
+       "Changing the state between every call!",
+       "Alternating state FillRectangle and Blit", "call-alternating", false,
+       0, 0, 0, "MCalls/sec", call_alternating },
      { "Load Image",
        "Loading image files!",
-       "Loading image files", "load-image <filename>", false,
+       "Loading image files", "load-image <file|dir>", false,
        0, 0, 0, "MPixel/sec", load_image },
+     { "Replay",
+       "Replaying recorded surface calls!",
+       "Replaying a trace", "replay <file>", false,
+       0, 0, 0, "Frames/sec", replay_trace },
 };
 
+/* built-in demos followed by those of the plug-ins */
+static Demo *demos     = builtin_demos;
+static int   num_demos = D_ARRAY_SIZE(builtin_demos);
+
+static void **plugin_handles     = NULL;
+static int    num_plugin_handles = 0;
+
 static Demo *current_demo;
 
+/* trace loaded for the replay benchmark */
+typedef struct {
+     u8                      *data;
+     size_t                   size;
+     const DFDokRecordHeader **records;
+     int                      num_records;
+     int                     *frames;         /* index of the first record of each frame, num_frames + 1 entries */
+     int                      num_frames;
+     int                      num_surfaces;   /* highest surface id + 1 */
+     IDirectFBSurface       **surfaces;       /* created by replay_setup(), NULL for primary surfaces */
+     bool                    *primary;        /* surface is (a sub-surface of) the primary, replayed on 'dest' */
+} ReplayTrace;
+
+static ReplayTrace        replay;
+
+/* reference checksums for verification */
+typedef struct {
+     char                 key[256];
+     u64                  hash;
+     int                  num_rows;
+     u32                 *rows;
+} VerifyReference;
+
+static VerifyReference *references         = NULL;
+static int              num_references     = 0;
+static bool             references_changed = false;
+
+static const char *verify_names[] = { "none", "ok", "failed", "recorded" };
+
 /* random function */
-static unsigned int rand_pool = 0x12345678;
-static unsigned int rand_add  = 0x87654321;
+static __thread unsigned int rand_pool = 0x12345678;
+static __thread unsigned int rand_add  = 0x87654321;
 
 static inline unsigned int myrand( void )
 {
@@ -290,6 +568,62 @@ static inline unsigned int myrand( void )
      return rand_pool;
 }
 
+/*
+ * Parameters of the benchmark operations are generated before the timed region,
+ * operation i uses entry i modulo BENCH_PARAMS of the tables.
+ */
+#define BENCH_PARAMS     1024
+#define BENCH_SPAN_SETS  64
+#define BENCH_BATCH_SETS 8
+#define BENCH_BATCH_MAX  4096
+
+typedef struct {
+     int                  x, y;       /* position of a SX x SY operation */
+     int                  tx, ty;     /* position of the benchmark string */
+     int                  sx, sy;     /* source offset within a 2*SX x 2*SY surface */
+     u8                   r, g, b, a; /* color, alpha is used for blending only */
+} BenchParam;
+
+static BenchParam    bench_params[BENCH_PARAMS];
+static DFBRectangle  bench_rects[BENCH_PARAMS + 10];
+static DFBRegion     bench_lines[BENCH_PARAMS + 10];
+static DFBTrapezoid  bench_traps[BENCH_PARAMS + 10];
+static DFBSpan      *bench_spans = NULL;       /* BENCH_SPAN_SETS sets of SY spans */
+
+/* BENCH_BATCH_SETS sets of batch_size elements for the batched benchmarks */
+static DFBRectangle *bench_batch_srects    = NULL;
+static DFBPoint     *bench_batch_points    = NULL;
+static DFBRectangle *bench_batch_drects    = NULL;
+static DFBTriangle  *bench_batch_triangles = NULL;
+static DFBVertex    *bench_batch_vertices  = NULL;  /* three per triangle */
+static unsigned long long bench_batch_pixels[BENCH_BATCH_SETS]; /* of the stretched rectangles */
+
+#define PARAM(i)              (&bench_params[(i) & (BENCH_PARAMS - 1)])
+#define PARAM_BATCH(table,i)  (&(table)[((i) * 10) & (BENCH_PARAMS - 1)])
+#define BATCH(table,i)        (&(table)[((i) & (BENCH_BATCH_SETS - 1)) * batch_size])
+
+/* destination formats of --porter-duff, also those supported by the reference check */
+#define PD_FORMATS "ARGB,RGB32,RGB16,A8"
+
+/* measured cost of one benchmark loop iteration without any operation */
+static double harness_overhead = 0;
+
+/* pixel offset from a 64 pixel boundary of destination and source x positions, -1 for random positions */
+static int bench_align_dst = -1;
+static int bench_align_src = -1;
+
+/* preallocated buffer of a destination with padded pitch, freed by release_dest() */
+typedef struct {
+     IDirectFBSurface *surface;
+     void             *data;
+} PaddedBuffer;
+
+static PaddedBuffer *padded_buffers     = NULL;
+static int           num_padded_buffers = 0;
+
+/* number of calls per loop iteration of the running call overhead benchmark */
+static int bench_calls = 1;
+
 /**********************************************************************************************************************/
 
 static const DirectFBPixelFormatNames(format_names)
@@ -315,10 +649,34 @@ static void print_usage( void )
      printf( "Options:\n\n" );
      printf( "  --duration <milliseconds>    Duration of each benchmark.\n" );
      printf( "  --iterations <num>           Number of iterations for each benchmark.\n" );
+     printf( "  --warmup <num>               Number of unrecorded warm-up iterations.\n" );
+     printf( "  --converge <percent>         Iterate samples of a tenth of the duration until the 95%% confidence interval\n"
+             "                               is within percent of the mean.\n" );
+     printf( "  --max-time <milliseconds>    Maximum time of each benchmark in convergence mode.\n" );
      printf( "  --size <width>x<height>      Set benchmark size.\n" );
      printf( "  --pixelformat <pixelformat>  Set benchmark pixelformat.\n" );
+     printf( "  --pixelformat-sweep [<list>] Run benchmarks for each of a comma separated list of pixelformats.\n" );
+     printf( "  --size-sweep [<min>-<max>]   Run benchmarks for doubling sizes from min (8) up to max (full screen).\n" );
+     printf( "  --align-sweep [dest|source]  Run benchmarks for each x offset in bytes from a 64 byte boundary.\n" );
+     printf( "  --pitch-pad <bytes>          Pad each line of the destination, which is allocated in system memory.\n" );
+     printf( "  --porter-duff [<list>]       Run all Porter-Duff benchmarks for each pixelformat (%s).\n", PD_FORMATS );
+     printf( "  --stretch-sweep              Run all stretch ratio benchmarks with nearest and smooth scaling.\n" );
+     printf( "  --yuv                        Run all YUV to RGB benchmarks, conversion only and scaled.\n" );
+     printf( "  --plugin-dir <directory>     Load benchmark plug-ins from the directory.\n" );
+     printf( "  --trace <filename>           Write a Chrome trace of all phases to a JSON file.\n" );
+     printf( "  --trace-calls                Add spans of the sampled batches of calls to the trace.\n" );
+     printf( "  --soak <minutes>             Cycle through the benchmarks and log throughput and resource usage.\n" );
+     printf( "  --soak-interval <seconds>    Logging interval of the soak mode (default 60).\n" );
+     printf( "  --drain                      Show the time for issuing and for completing the operations.\n" );
+     printf( "  --perf                       Capture hardware performance counters of each benchmark.\n" );
+     printf( "  --cold [<bytes>[K|M|G]]      Rotate blit sources through copies exceeding bytes (default 4 x LLC).\n" );
+     printf( "  --load-fresh                 Create a new surface for each loaded image instead of reusing one.\n" );
+     printf( "  --batch <n>                  Number of operations per call of batched benchmarks (1..%d, default 10).\n",
+             BENCH_BATCH_MAX );
+     printf( "  --ui-size <width>x<height>   Target resolution of the UI frame benchmark (default full screen).\n" );
      printf( "  --system                     Do benchmarks in system memory.\n" );
      printf( "  --dump                       Dump output of each benchmark to a file.\n" );
+     printf( "  --dump-format <format>       Dump as 'ppm' (default), or as 'png' or 'raw' written in the background.\n" );
      printf( "  --wait <seconds>             Wait a few seconds after each benchmark.\n" );
      printf( "  --noaccel                    Don't use hardware acceleration.\n" );
      printf( "  --accelonly                  Only show accelerated benchmarks.\n" );
@@ -329,30 +687,482 @@ static void print_usage( void )
      printf( "  --noresults                  Don't show results screen.\n" );
      printf( "  --all-demos                  Run all benchmarks.\n" );
      printf( "  --csv                        Output comma separated values.\n" );
+     printf( "  --json <filename>            Write all iterations and statistics to a JSON file.\n" );
+     printf( "  --latency [<calls>]          Record per-call latency histograms, timed in batches of calls.\n" );
+     printf( "  --threads <num>              Run each benchmark in 1 to num threads (0 = number of CPUs).\n" );
+     printf( "  --verify <filename>          Check a fixed number of operations against reference checksums.\n" );
+     printf( "  --verify-ops <num>           Number of operations rendered for verification.\n" );
      printf( "  --fullscreen                 Run fullscreen (without status bar).\n" );
      printf( "  --intro                      Display intro screen before each benchmark.\n" );
      printf( "  --help                       Print usage information.\n" );
      printf( "  --dfb-help                   Output DirectFB usage information.\n\n" );
      printf( "The following options allow to specify which benchmarks to run.\n" );
      printf( "If none of these are given, all benchmarks requested by default are run.\n\n" );
-     for (i = 0; i < D_ARRAY_SIZE(demos); i++) {
+     for (i = 0; i < num_demos; i++) {
           printf( "  --%-26s %s\n", demos[i].option, demos[i].desc );
      }
      printf( "\n" );
 }
 
+/**********************************************************************************************************************/
+
+/*
+ * Hardware performance counters of the timed regions, counted for the calling thread and threads created while
+ * enabled. Counters that cannot be opened (e.g. in containers or without kernel support) are reported as n/a.
+ */
+typedef enum {
+     PERF_CYCLES,
+     PERF_INSTRUCTIONS,
+     PERF_CACHE_MISSES,
+     PERF_BRANCH_MISSES,
+     PERF_PAGE_FAULTS,
+     PERF_COUNTERS
+} PerfCounter;
+
+static int                perf_fds[PERF_COUNTERS] = { -1, -1, -1, -1, -1 };
+static unsigned long long perf_counts[PERF_COUNTERS];
+static unsigned long long perf_ops;
+
+static bool perf_open( void )
+{
+     bool ok = false;
+#ifdef __linux__
+     static const struct {
+          unsigned int        type;
+          unsigned long long  config;
+     } events[PERF_COUNTERS] = {
+          { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES       },
+          { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS     },
+          { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES     },
+          { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES    },
+          { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS      }
+     };
+     int i;
+
+     for (i = 0; i < PERF_COUNTERS; i++) {
+          struct perf_event_attr attr;
+
+          memset( &attr, 0, sizeof(attr) );
+
+          attr.size           = sizeof(attr);
+          attr.type           = events[i].type;
+          attr.config         = events[i].config;
+          attr.disabled       = 1;
+          attr.inherit        = 1;
+          attr.exclude_kernel = 1;
+          attr.exclude_hv     = 1;
+          attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+          perf_fds[i] = syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 );
+          if (perf_fds[i] >= 0)
+               ok = true;
+     }
+#endif
+
+     return ok;
+}
+
+static void perf_close( void )
+{
+#ifdef __linux__
+     int i;
+
+     for (i = 0; i < PERF_COUNTERS; i++) {
+          if (perf_fds[i] >= 0)
+               close( perf_fds[i] );
+
+          perf_fds[i] = -1;
+     }
+#endif
+}
+
+static void perf_reset( void )
+{
+#ifdef __linux__
+     int i;
+
+     for (i = 0; i < PERF_COUNTERS; i++) {
+          if (perf_fds[i] >= 0)
+               ioctl( perf_fds[i], PERF_EVENT_IOC_RESET, 0 );
+     }
+#endif
+
+     memset( perf_counts, 0, sizeof(perf_counts) );
+
+     perf_ops = 0;
+}
+
+static void perf_enable( bool enable )
+{
+#ifdef __linux__
+     int i;
+
+     for (i = 0; i < PERF_COUNTERS; i++) {
+          if (perf_fds[i] >= 0)
+               ioctl( perf_fds[i], enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0 );
+     }
+#endif
+}
+
+/* read the counters, scaled up if they were multiplexed */
+static void perf_read( void )
+{
+#ifdef __linux__
+     int i;
+
+     for (i = 0; i < PERF_COUNTERS; i++) {
+          unsigned long long values[3];
+
+          if (perf_fds[i] < 0 || read( perf_fds[i], values, sizeof(values) ) != sizeof(values))
+               continue;
+
+          perf_counts[i] = values[2] ? (unsigned long long) ((double) values[0] * values[1] / values[2]) : 0;
+     }
+#endif
+}
+
+/* append the IPC and the counts per amount of the unit, e.g. per MPixel, to the result line */
+static void perf_print( const Demo *demo )
+{
+     int                 i;
+     int                 unit_len;
+     double              per_unit;
+     static const char  *names[PERF_COUNTERS] = { "cycles", "instructions", "cache-misses", "branch-misses",
+                                                   "page-faults" };
+
+     if (!do_perf || !perf_ops)
+          return;
+
+     /* the raw count is in millionths of the unit, e.g. pixels for MPixel/sec and frames * 1000000 for Frames/sec */
+     unit_len = strcspn( demo->unit, "/" );
+
+     perf_read();
+
+     if (perf_fds[PERF_CYCLES] >= 0 && perf_fds[PERF_INSTRUCTIONS] >= 0 && perf_counts[PERF_CYCLES])
+          printf( output_csv ? ",%.3f" : "\n     perf: IPC %.3f", (double) perf_counts[PERF_INSTRUCTIONS] /
+                  perf_counts[PERF_CYCLES] );
+     else
+          printf( output_csv ? "," : "\n     perf: IPC n/a" );
+
+     for (i = 0; i < PERF_COUNTERS; i++) {
+          if (i == PERF_INSTRUCTIONS)
+               continue;
+
+          per_unit = perf_counts[i] * 1000000.0 / perf_ops;
+
+          if (output_csv)
+               printf( perf_fds[i] < 0 ? "," : ",%.1f", per_unit );
+          else if (perf_fds[i] < 0)
+               printf( "  %s n/a", names[i] );
+          else
+               printf( "  %s/%.*s %.1f", names[i], unit_len, demo->unit, per_unit );
+     }
+}
+
+/**********************************************************************************************************************/
+
+/* complete events of the Chrome trace event format, timestamps in microseconds of the monotonic clock */
+typedef struct {
+     const char          *name;
+     const char          *cat;
+     long long            ts;
+     long long            dur;
+     int                  tid;
+     long                 calls;      /* number of calls of a sampled batch, -1 if not a batch */
+} TraceEvent;
+
+static DirectMutex  trace_lock;
+static TraceEvent  *trace_events     = NULL;
+static int          num_trace_events = 0;
+
+static inline long long trace_begin( void )
+{
+     return trace_filename ? direct_clock_get_micros() : 0;
+}
+
+static void trace_add( const char *name, const char *cat, long long begin, long long end, long calls )
+{
+     TraceEvent *event;
+
+     direct_mutex_lock( &trace_lock );
+
+     if (!(num_trace_events % 1024)) {
+          trace_events = D_REALLOC( trace_events, (num_trace_events + 1024) * sizeof(TraceEvent) );
+          if (!trace_events) {
+               fprintf( stderr, "Out of memory!\n" );
+               exit( 1 );
+          }
+     }
+
+     event = &trace_events[num_trace_events++];
+
+     event->name  = name;
+     event->cat   = cat;
+     event->ts    = begin;
+     event->dur   = end - begin;
+     event->tid   = direct_gettid();
+     event->calls = calls;
+
+     direct_mutex_unlock( &trace_lock );
+}
+
+static inline void trace_end( const char *name, const char *cat, long long begin )
+{
+     if (trace_filename)
+          trace_add( name, cat, begin, direct_clock_get_micros(), -1 );
+}
+
+/**********************************************************************************************************************/
+
+/*
+ * Source rings of the cold cache mode. Blit benchmarks rotate through copies of their source image, enough of them
+ * to exceed the byte budget, so that the source data is read from memory instead of the cache. Only the ring of the
+ * running benchmark is kept, the time for creating it is not measured.
+ */
+typedef struct {
+     IDirectFBSurface    *image;
+     IDirectFBSurface   **surfaces;
+     int                  num;        /* 0 if not in cold cache mode */
+} SourceRing;
+
+#define RING_SOURCE(ring,i) ((ring).num ? (ring).surfaces[(i) % (ring).num] : (ring).image)
+
+static SourceRing  cold_ring;
+static DirectMutex cold_lock;
+
+/* milliseconds within the running benchmark that are not measured */
+static __thread long long bench_excluded = 0;
+
+/* size of the last level cache in bytes */
+static long long llc_size( void )
+{
+     int       i;
+     int       max_level = 0;
+     long long size      = 0;
+
+     for (i = 0; i < 16; i++) {
+          char  path[64];
+          char  unit = 0;
+          int   level;
+          long  value;
+          FILE *f;
+
+          snprintf( path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", i );
+
+          f = fopen( path, "r" );
+          if (!f)
+               break;
+
+          if (fscanf( f, "%d", &level ) != 1)
+               level = 0;
+
+          fclose( f );
+
+          snprintf( path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", i );
+
+          f = fopen( path, "r" );
+          if (!f)
+               continue;
+
+          if (fscanf( f, "%ld%c", &value, &unit ) >= 1 && level >= max_level) {
+               max_level = level;
+               size      = value * (unit == 'K' ? 1024LL : unit == 'M' ? 1024LL * 1024 : 1);
+          }
+
+          fclose( f );
+     }
+
+     return size ?: 8 * 1024 * 1024;
+}
+
+static void cold_release( void )
+{
+     int i;
+
+     for (i = 0; i < cold_ring.num; i++)
+          cold_ring.surfaces[i]->Release( cold_ring.surfaces[i] );
+
+     if (cold_ring.surfaces)
+          D_FREE( cold_ring.surfaces );
+
+     memset( &cold_ring, 0, sizeof(cold_ring) );
+}
+
+/* ring of copies of the image in cold cache mode, otherwise just the image */
+static SourceRing source_ring( IDirectFBSurface *image )
+{
+     SourceRing ring = { image, NULL, 0 };
+     long long  start;
+
+     if (!cold_budget)
+          return ring;
+
+     /* waiting for another thread building the ring is excluded as well */
+     start = direct_clock_get_millis();
+
+     direct_mutex_lock( &cold_lock );
+
+     if (cold_ring.image != image) {
+          int                     i, w, h, num;
+          long long               bytes;
+          long long               trace = trace_begin();
+          DFBSurfaceDescription   sdsc;
+          DFBSurfaceCapabilities  caps;
+          IDirectFBPalette       *palette = NULL;
+
+          cold_release();
+
+          image->GetSize( image, &w, &h );
+          image->GetCapabilities( image, &caps );
+
+          sdsc.flags  = DSDESC_WIDTH | DSDESC_HEIGHT | DSDESC_PIXELFORMAT | DSDESC_CAPS;
+          sdsc.width  = w;
+          sdsc.height = h;
+          sdsc.caps   = caps & (DSCAPS_SYSTEMONLY | DSCAPS_VIDEOONLY | DSCAPS_PREMULTIPLIED);
+
+          image->GetPixelFormat( image, &sdsc.pixelformat );
+
+          bytes = (long long) DFB_BYTES_PER_LINE( sdsc.pixelformat, w ) * DFB_PLANE_MULTIPLY( sdsc.pixelformat, h );
+          num   = MIN( cold_budget / MAX( bytes, 1 ) + 1, INT_MAX );
+
+          cold_ring.surfaces = D_CALLOC( num, sizeof(IDirectFBSurface*) );
+
+          if (DFB_PIXELFORMAT_IS_INDEXED( sdsc.pixelformat ))
+               image->GetPalette( image, &palette );
+
+          for (i = 0; cold_ring.surfaces && i < num; i++) {
+               IDirectFBSurface *copy;
+
+               if (dfb->CreateSurface( dfb, &sdsc, &copy ))
+                    break;
+
+               if (do_noaccel)
+                    copy->DisableAcceleration( copy, DFXL_ALL );
+
+               if (palette)
+                    copy->SetPalette( copy, palette );
+
+               /* the key is state of the surface, there is no way to query it */
+               if (image == colorkeyed)
+                    copy->SetSrcColorKey( copy, colorkey.r, colorkey.g, colorkey.b );
+
+               copy->Blit( copy, image, NULL, 0, 0 );
+
+               cold_ring.surfaces[cold_ring.num++] = copy;
+          }
+
+          if (cold_ring.num < num)
+               fprintf( stderr, "Only %d of %d copies of the source could be created!\n", cold_ring.num, num );
+
+          if (palette)
+               palette->Release( palette );
+
+          cold_ring.image = image;
+
+          dfb->WaitIdle( dfb );
+
+          trace_end( "source ring", "setup", trace );
+     }
+
+     ring = cold_ring;
+
+     direct_mutex_unlock( &cold_lock );
+
+     bench_excluded += direct_clock_get_millis() - start;
+
+     return ring;
+}
+
+/**********************************************************************************************************************/
+
+static void release_images( void )
+{
+     cold_release();
+
+     if (image8a)    image8a->Release( image8a );
+     if (image32a)   image32a->Release( image32a );
+     if (image32)    image32->Release( image32 );
+     if (colorkeyed) colorkeyed->Release( colorkeyed );
+     if (simple)     simple->Release( simple );
+     if (rose_pre)   rose_pre->Release( rose_pre );
+     if (rose)       rose->Release( rose );
+     if (swirl)      swirl->Release( swirl );
+
+     image8a    = NULL;
+     image32a   = NULL;
+     image32    = NULL;
+     colorkeyed = NULL;
+     simple     = NULL;
+     rose_pre   = NULL;
+     rose       = NULL;
+     swirl      = NULL;
+}
+
 static void dfb_shutdown( void )
 {
+     int i;
+
+     if (bench_spans)
+          D_FREE( bench_spans );
+
+     if (bench_batch_srects)
+          D_FREE( bench_batch_srects );
+
+     if (bench_batch_points)
+          D_FREE( bench_batch_points );
+
+     if (bench_batch_drects)
+          D_FREE( bench_batch_drects );
+
+     if (bench_batch_triangles)
+          D_FREE( bench_batch_triangles );
+
+     if (bench_batch_vertices)
+          D_FREE( bench_batch_vertices );
+
+     perf_close();
+
+     if (trace_events)
+          D_FREE( trace_events );
+
+     if (trace_filename)
+          direct_mutex_deinit( &trace_lock );
+
+     if (cold_budget)
+          direct_mutex_deinit( &cold_lock );
+
+     if (replay.records)
+          D_FREE( replay.records );
+
+     if (replay.frames)
+          D_FREE( replay.frames );
+
+     if (replay.data)
+          D_FREE( replay.data );
+
+     for (i = 0; i < num_image_files; i++)
+          D_FREE( image_files[i] );
+
+     if (image_files)
+          D_FREE( image_files );
+
+     for (i = 0; i < num_references; i++)
+          D_FREE( references[i].rows );
+
+     if (references)
+          D_FREE( references );
+
+     for (i = 0; i < num_demos; i++) {
+          if (demos[i].latency)
+               D_FREE( demos[i].latency );
+
+          if (demos[i].samples)
+               D_FREE( demos[i].samples );
+     }
+
      if (dest)                dest->Release( dest );
      if (with_intro && intro) intro->Release( intro );
-     if (image8a)             image8a->Release( image8a );
-     if (image32a)            image32a->Release( image32a );
-     if (image32)             image32->Release( image32 );
-     if (colorkeyed)          colorkeyed->Release( colorkeyed );
-     if (simple)              simple->Release( simple );
-     if (rose_pre)            rose_pre->Release( rose_pre );
-     if (rose)                rose->Release( rose );
-     if (swirl)               swirl->Release( swirl );
+     release_images();
      if (cardicon)            cardicon->Release( cardicon );
      if (logo)                logo->Release( logo );
      if (ui_font)             ui_font->Release( ui_font );
@@ -360,6 +1170,23 @@ static void dfb_shutdown( void )
      if (primary)             primary->Release( primary );
      if (event_buffer)        event_buffer->Release( event_buffer );
      if (dfb)                 dfb->Release( dfb );
+
+     if (demos != builtin_demos)
+          D_FREE( demos );
+
+     for (i = 0; i < num_padded_buffers; i++)
+          D_FREE( padded_buffers[i].data );
+
+     if (padded_buffers)
+          D_FREE( padded_buffers );
+
+#ifdef HAVE_DLOPEN
+     for (i = 0; i < num_plugin_handles; i++)
+          dlclose( plugin_handles[i] );
+#endif
+
+     if (plugin_handles)
+          D_FREE( plugin_handles );
 }
 
 static void showMessage( const char *msg )
@@ -417,7 +1244,7 @@ static void showResult( void )
      long                      max_result = 0;
      double                    factor;
 
-     for (i = 0; i < D_ARRAY_SIZE(demos); i++) {
+     for (i = 0; i < num_demos; i++) {
           if (!demos[i].requested || !demos[i].result)
                continue;
 
@@ -455,7 +1282,7 @@ static void showResult( void )
 
      primary->SetColor( primary, 0x66, 0x66, 0x66, 0xFF );
 
-     for (i = 0; i < D_ARRAY_SIZE(demos); i++) {
+     for (i = 0; i < num_demos; i++) {
           if (!demos[i].requested || !demos[i].result)
                continue;
 
@@ -470,7 +1297,7 @@ static void showResult( void )
      meter->Release( meter );
 
      y = ui_fontheight + sdsc.height / 2;
-     for (i = 0; i < D_ARRAY_SIZE(demos); i++) {
+     for (i = 0; i < num_demos; i++) {
           if (!demos[i].requested || !demos[i].result)
                continue;
 
@@ -494,7 +1321,7 @@ static void showResult( void )
      DFBCHECK(cardicon->GetSize( cardicon, &w, &h ));
 
      y = ui_fontheight + sdsc.height / 2;
-     for (i = 0; i < D_ARRAY_SIZE(demos); i++) {
+     for (i = 0; i < num_demos; i++) {
           if (!demos[i].requested || !demos[i].result)
                continue;
 
@@ -539,10 +1366,14 @@ static bool showAccelerated( DFBAccelerationMask func, IDirectFBSurface *source
 
      DFBCHECK(dest->GetAccelerationMask( dest, source, &mask ));
 
-     if (mask & func)
-          current_demo->accelerated = DFB_TRUE;
+     if (mask & func) {
+          if (bench_worker)
+               bench_accelerated = true;
+          else
+               current_demo->accelerated = DFB_TRUE;
+     }
 
-     if (!run_fullscreen) {
+     if (!run_fullscreen && !bench_worker) {
           if (mask & func) {
                primary->SetBlittingFlags( primary, DSBLIT_SRC_COLORKEY );
           }
@@ -559,290 +1390,473 @@ static bool showAccelerated( DFBAccelerationMask func, IDirectFBSurface *source
 
 /**********************************************************************************************************************/
 
-#define SET_BLITTING_FLAGS(flags) \
-     dest->SetBlittingFlags( dest, (flags) | (do_xor ? DSBLIT_XOR : 0) )
-
-#define SET_DRAWING_FLAGS(flags) \
-     dest->SetDrawingFlags( dest, (flags) | (do_xor ? DSDRAW_XOR : 0) )
-
-static unsigned long long draw_string( long long t )
+static inline long long nanos( void )
 {
-     long i;
+     struct timespec ts;
 
-     SET_DRAWING_FLAGS( DSDRAW_NOFX );
+     clock_gettime( CLOCK_MONOTONIC, &ts );
 
-     if (!showAccelerated( DFXL_DRAWSTRING, NULL ))
-          return 0;
+     return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          dest->SetColor( dest, myrand() & 0xFF, myrand() & 0xFF, myrand() & 0xFF, 0xFF );
-          dest->DrawString( dest, "This is the DirectFB Benchmarking!!!", -1,
-                            SW - bench_stringwidth > 0 ? myrand() % (SW - bench_stringwidth) : 0,
-                            myrand() % (SH - bench_fontheight), DSTF_TOPLEFT );
-     }
+/* CPU time of all threads of the process */
+static inline long long cpu_nanos( void )
+{
+     struct timespec ts;
 
-     return 1000 * 36 * (unsigned long long) i;
+     clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &ts );
+
+     return ts.tv_sec * 1000000000LL + ts.tv_nsec;
 }
 
-static unsigned long long draw_string_blend( long long t )
+static void latency_add( LatencyHistogram *hist, unsigned long long value )
 {
-     long i;
-
-     SET_DRAWING_FLAGS( DSDRAW_BLEND );
+     int bits = value ? 63 - __builtin_clzll( value ) : 0;
+     int index;
 
-     dest->SetColor( dest, 0x80, 0x80, 0x80, 0x80 );
+     if (bits > LATENCY_MAX_BITS)
+          bits = LATENCY_MAX_BITS;
 
-     if (!showAccelerated( DFXL_DRAWSTRING, NULL ))
-          return 0;
+     if (bits < LATENCY_SUB_BITS)
+          index = value;
+     else
+          index = (bits - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS +
+                  ((value >> (bits - LATENCY_SUB_BITS)) & (LATENCY_SUB_BUCKETS - 1));
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          dest->SetColor( dest, myrand() & 0xFF, myrand() & 0xFF, myrand() & 0xFF, myrand() % 0x64 );
-          dest->DrawString( dest, "This is the DirectFB Benchmarking!!!", -1,
-                            SW - bench_stringwidth > 0 ? myrand() % (SW - bench_stringwidth) : 0,
-                            myrand() % (SH - bench_fontheight), DSTF_TOPLEFT );
-     }
+     hist->buckets[MIN( index, LATENCY_BUCKETS - 1 )]++;
+     hist->count++;
 
-     return 1000 * 36 * (unsigned long long) i;
+     if (hist->max < value)
+          hist->max = value;
 }
 
-static unsigned long long fill_rect( long long t )
+/* middle of the bucket */
+static double latency_bucket_value( int index )
 {
-     long i;
+     int                bits;
+     unsigned long long base;
 
-     SET_DRAWING_FLAGS( DSDRAW_NOFX );
-
-     if (!showAccelerated( DFXL_FILLRECTANGLE, NULL ))
-          return 0;
+     if (index < LATENCY_SUB_BUCKETS)
+          return index;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          dest->SetColor( dest, myrand() & 0xFF, myrand() & 0xFF, myrand() & 0xFF, 0xFF );
-          dest->FillRectangle( dest, SW != SX ? myrand() % (SW - SX) : 0, SH != SY ? myrand() % (SH - SY) : 0, SX, SY );
-     }
+     bits = index / LATENCY_SUB_BUCKETS + LATENCY_SUB_BITS - 1;
+     base = (unsigned long long) (LATENCY_SUB_BUCKETS + index % LATENCY_SUB_BUCKETS) << (bits - LATENCY_SUB_BITS);
 
-     return SX * SY * (unsigned long long) i;
+     return base + (1ULL << (bits - LATENCY_SUB_BITS)) / 2.0;
 }
 
-static unsigned long long fill_rect_blend( long long t )
+static double latency_percentile( const LatencyHistogram *hist, double p )
 {
-     long i;
+     int                i;
+     unsigned long long sum    = 0;
+     unsigned long long target = (hist->count * p + 99) / 100;
 
-     SET_DRAWING_FLAGS( DSDRAW_BLEND );
-
-     if (!showAccelerated( DFXL_FILLRECTANGLE, NULL ))
+     if (!hist->count)
           return 0;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          dest->SetColor( dest, myrand() & 0xFF, myrand() & 0xFF, myrand() & 0xFF, myrand() % 0x64 );
-          dest->FillRectangle( dest, SW != SX ? myrand() % (SW - SX) : 0, SH != SY ? myrand() % (SH - SY) : 0, SX, SY );
+     for (i = 0; i < LATENCY_BUCKETS; i++) {
+          sum += hist->buckets[i];
+
+          if (sum >= target && hist->buckets[i])
+               return MIN( latency_bucket_value( i ), hist->max );
      }
 
-     return SX * SY * (unsigned long long) i;
+     return hist->max;
 }
 
-static unsigned long long fill_rects( long long t )
-{
-     long         i, l;
-     DFBRectangle rects[10];
-
-     SET_DRAWING_FLAGS( DSDRAW_NOFX );
-
-     if (!showAccelerated( DFXL_FILLRECTANGLE, NULL ))
-          return 0;
+/**********************************************************************************************************************/
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          for (l = 0; l < 10; l++) {
-               rects[l].x = (SW != SX) ? myrand() % (SW - SX) : 0;
-               rects[l].y = (SH != SY) ? myrand() % (SH - SY) : 0;
-               rects[l].w = SX;
-               rects[l].h = SY;
+static void add_sample( Demo *demo, const DemoSample *sample )
+{
+     if (!(demo->num_samples % 16)) {
+          demo->samples = D_REALLOC( demo->samples, (demo->num_samples + 16) * sizeof(DemoSample) );
+          if (!demo->samples) {
+               fprintf( stderr, "Out of memory!\n" );
+               exit( 1 );
           }
-
-          dest->SetColor( dest, myrand() & 0xFF, myrand() & 0xFF, myrand() & 0xFF, 0xFF );
-          dest->FillRectangles( dest, rects, 10 );
      }
 
-     return SX * SY * 10 * (unsigned long long) i;
+     demo->samples[demo->num_samples++] = *sample;
 }
 
-static unsigned long long fill_rects_blend( long long t )
+static int compare_double( const void *a, const void *b )
 {
-     long         i, l;
-     DFBRectangle rects[10];
+     const double *da = a;
+     const double *db = b;
 
-     SET_DRAWING_FLAGS( DSDRAW_BLEND );
+     return (*da > *db) - (*da < *db);
+}
 
-     if (!showAccelerated( DFXL_FILLRECTANGLE, NULL ))
-          return 0;
+/* linear interpolation between the closest ranks of a sorted array */
+static double percentile( const double *sorted, int num, double p )
+{
+     double rank;
+     int    index;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          for (l = 0; l < 10; l++) {
-               rects[l].x = (SW != SX) ? myrand() % (SW - SX) : 0;
-               rects[l].y = (SH != SY) ? myrand() % (SH - SY) : 0;
-               rects[l].w = SX;
-               rects[l].h = SY;
-          }
+     if (num < 2)
+          return num ? sorted[0] : 0;
 
-          dest->SetColor( dest, myrand() & 0xFF, myrand() & 0xFF, myrand() & 0xFF, myrand() % 0x64 );
-          dest->FillRectangles( dest, rects, 10 );
-     }
+     rank  = p / 100 * (num - 1);
+     index = rank;
 
-     return SX * SY * 10 * (unsigned long long) i;
+     if (index >= num - 1)
+          return sorted[num-1];
+
+     return sorted[index] + (rank - index) * (sorted[index+1] - sorted[index]);
 }
 
-static unsigned long long fill_triangle( long long t )
+/* two-sided 95% quantile of the Student's t-distribution */
+static double student_t95( int df )
 {
-     long i, x, y;
-
-     SET_DRAWING_FLAGS( DSDRAW_NOFX );
+     static const double t95[] = {
+          12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+           2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+           2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+     };
 
-     if (!showAccelerated( DFXL_FILLTRIANGLE, NULL ))
+     if (df < 1)
           return 0;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          x = (SW != SX) ? myrand() % (SW - SX) : 0;
-          y = (SH != SY) ? myrand() % (SH - SY) : 0;
+     if (df > D_ARRAY_SIZE(t95))
+          return 1.960;
 
-          dest->SetColor( dest, myrand() & 0xFF, myrand() & 0xFF, myrand() & 0xFF, 0xFF );
-          dest->FillTriangle( dest, x, y, x + SX - 1, y + SY / 2, x, y + SY - 1 );
-     }
+     return t95[df-1];
+}
 
-     return SX * SY * (unsigned long long) i / 2;
+/* throughput of a single sample in the unit of the demo */
+static double sample_rate( const DemoSample *sample )
+{
+     return sample->elapsed ? (double) sample->ops / sample->elapsed / 1000 : 0;
 }
 
-static unsigned long long fill_triangle_blend( long long t )
+static void calc_stats( const Demo *demo, DemoStats *stats )
 {
-     long i, x, y;
+     int     i;
+     double  sum = 0, var = 0;
+     double *rates;
 
-     SET_DRAWING_FLAGS( DSDRAW_BLEND );
+     memset( stats, 0, sizeof(DemoStats) );
 
-     if (!showAccelerated( DFXL_FILLTRIANGLE, NULL ))
-          return 0;
+     if (!demo->num_samples)
+          return;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          x = (SW != SX) ? myrand() % (SW - SX) : 0;
-          y = (SH != SY) ? myrand() % (SH - SY) : 0;
+     rates = D_MALLOC( demo->num_samples * sizeof(double) );
+     if (!rates)
+          return;
 
-          dest->SetColor( dest, myrand() & 0xFF, myrand() & 0xFF, myrand() & 0xFF, myrand() % 0x64 );
-          dest->FillTriangle( dest, x, y, x + SX - 1, y + SY / 2, x, y + SY - 1 );
+     for (i = 0; i < demo->num_samples; i++) {
+          rates[i] = sample_rate( &demo->samples[i] );
+          sum += rates[i];
      }
 
-     return SX * SY * (unsigned long long) i / 2;
+     stats->mean = sum / demo->num_samples;
+
+     for (i = 0; i < demo->num_samples; i++)
+          var += (rates[i] - stats->mean) * (rates[i] - stats->mean);
+
+     if (demo->num_samples > 1)
+          stats->stddev = sqrt( var / (demo->num_samples - 1) );
+
+     qsort( rates, demo->num_samples, sizeof(double), compare_double );
+
+     if (demo->num_samples > 1)
+          stats->ci95 = student_t95( demo->num_samples - 1 ) * stats->stddev / sqrt( demo->num_samples );
+
+     stats->min    = rates[0];
+     stats->median = percentile( rates, demo->num_samples, 50 );
+     stats->p95    = percentile( rates, demo->num_samples, 95 );
+
+     D_FREE( rates );
 }
 
-static unsigned long long draw_rect( long long t )
+static bool converged( const Demo *demo )
 {
-     long i;
+     DemoStats stats;
 
-     SET_DRAWING_FLAGS( DSDRAW_NOFX );
+     if (demo->num_samples < 3)
+          return false;
 
-     if (!showAccelerated( DFXL_DRAWRECTANGLE, NULL ))
-          return 0;
+     calc_stats( demo, &stats );
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          dest->SetColor( dest, myrand() & 0xFF, myrand() & 0xFF, myrand() & 0xFF, 0xFF );
-          dest->DrawRectangle( dest, SW != SX ? myrand() % (SW - SX) : 0, SH != SY ? myrand() % (SH - SY) : 0, SX, SY );
+     return stats.ci95 <= stats.mean * converge / 100;
+}
+
+static void json_string( FILE *f, const char *str )
+{
+     fputc( '"', f );
+
+     for (; *str; str++) {
+          if (*str == '"' || *str == '\\')
+               fprintf( f, "\\%c", *str );
+          else if ((unsigned char) *str < 0x20)
+               fprintf( f, "\\u%04x", *str );
+          else
+               fputc( *str, f );
      }
 
-     return 1000 * (unsigned long long) i;
+     fputc( '"', f );
 }
 
-static unsigned long long draw_rect_blend( long long t )
+/* benchmarks of the previous columns of a sweep */
+static FILE *json_sweep       = NULL;
+static bool  json_sweep_first = true;
+
+/* write the samples and statistics of the requested demos, labeled with the sweep column if any */
+static void write_json_benchmarks( FILE *f, const char *column, bool *first )
 {
-     long i;
+     int i, j;
 
-     SET_DRAWING_FLAGS( DSDRAW_BLEND );
+     for (i = 0; i < num_demos; i++) {
+          DemoStats stats;
 
-     if (!showAccelerated( DFXL_DRAWRECTANGLE, NULL ))
-          return 0;
+          if (!demos[i].requested || !demos[i].num_samples)
+               continue;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          dest->SetColor( dest, myrand() & 0xFF, myrand() & 0xFF, myrand() & 0xFF, myrand() % 0x64 );
-          dest->DrawRectangle( dest, SW != SX ? myrand() % (SW - SX) : 0, SH != SY ? myrand() % (SH - SY) : 0, SX, SY );
-     }
+          calc_stats( &demos[i], &stats );
 
-     return 1000 * (unsigned long long) i;
+          fprintf( f, "%s\n    {\n      \"name\": ", *first ? "" : "," );
+          json_string( f, demos[i].desc );
+          fprintf( f, ",\n      \"option\": " );
+          json_string( f, demos[i].option );
+          if (column) {
+               fprintf( f, ",\n      \"column\": " );
+               json_string( f, column );
+          }
+          fprintf( f, ",\n      \"unit\": " );
+          json_string( f, demos[i].unit );
+          fprintf( f, ",\n      \"accelerated\": %s,\n", demos[i].accelerated ? "true" : "false" );
+          if (demos[i].verify)
+               fprintf( f, "      \"verify\": \"%s\",\n", verify_names[demos[i].verify] );
+          fprintf( f, "      \"samples\": [" );
+
+          for (j = 0; j < demos[i].num_samples; j++) {
+               const DemoSample *sample = &demos[i].samples[j];
+
+               fprintf( f, "%s\n        { \"ops\": %llu, \"elapsed_ms\": %lld, \"load\": %d.%d, \"rate\": %.3f, "
+                        "\"submit_ns\": %lld, \"drain_ns\": %lld, \"drain_idle\": %d.%d }",
+                        j ? "," : "", sample->ops, sample->elapsed, sample->load / 10, sample->load % 10,
+                        sample_rate( sample ), sample->submit, sample->drain,
+                        sample->drain_idle / 10, sample->drain_idle % 10 );
+          }
+
+          fprintf( f, "\n      ],\n" );
+          fprintf( f, "      \"stats\": { \"min\": %.3f, \"median\": %.3f, \"mean\": %.3f, \"stddev\": %.3f, "
+                   "\"p95\": %.3f, \"ci95\": [ %.3f, %.3f ] }",
+                   stats.min, stats.median, stats.mean, stats.stddev, stats.p95,
+                   stats.mean - stats.ci95, stats.mean + stats.ci95 );
+
+          if (demos[i].latency && demos[i].latency->count) {
+               const LatencyHistogram *hist = demos[i].latency;
+
+               fprintf( f, ",\n      \"latency_ns\": { \"batch\": %d, \"count\": %llu, \"p50\": %.0f, \"p90\": %.0f, "
+                        "\"p99\": %.0f, \"p99.9\": %.0f, \"max\": %llu }",
+                        latency_batch, hist->count, latency_percentile( hist, 50 ), latency_percentile( hist, 90 ),
+                        latency_percentile( hist, 99 ), latency_percentile( hist, 99.9 ), hist->max );
+          }
+
+          fprintf( f, "\n    }" );
+
+          *first = false;
+     }
 }
 
-static unsigned long long draw_lines( long long t )
+/* keep the results of a sweep column, the samples are reset for the next one */
+static void json_add_column( const char *column )
 {
-     long      i, l, x, y, dx, dy;
-     DFBRegion lines[10];
+     if (!json_filename)
+          return;
 
-     SET_DRAWING_FLAGS( DSDRAW_NOFX );
+     if (!json_sweep) {
+          json_sweep = tmpfile();
+          if (!json_sweep) {
+               fprintf( stderr, "Could not create a temporary file for the JSON output!\n" );
+               return;
+          }
 
-     if (!showAccelerated( DFXL_DRAWLINE, NULL ))
-          return 0;
+          json_sweep_first = true;
+     }
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          for (l = 0; l < 10; l++) {
-               x  = myrand() % (SW - SX) + SX / 2;
-               y  = myrand() % (SH - SY) + SY / 2;
-               dx = myrand() % (2 * SX) - SX;
-               dy = myrand() % (2 * SY) - SY;
+     write_json_benchmarks( json_sweep, column, &json_sweep_first );
+}
 
-               lines[l].x1 = x - dx / 2;
-               lines[l].y1 = y - dy / 2;
-               lines[l].x2 = x + dx / 2;
-               lines[l].y2 = y + dy / 2;
-          }
+static void write_json( const char *name )
+{
+     bool  first = true;
+     FILE *f;
 
-          dest->SetColor( dest, myrand() & 0xFF, myrand() & 0xFF, myrand() & 0xFF, 0xFF );
-          dest->DrawLines( dest, lines, 10 );
+     f = fopen( name, "w" );
+     if (!f) {
+          fprintf( stderr, "Could not open '%s' for writing!\n", name );
+          return;
      }
 
-     return 1000 * 10 * (unsigned long long) i;
+     fprintf( f, "{\n" );
+     fprintf( f, "  \"size\": { \"width\": %d, \"height\": %d },\n", SX, SY );
+     fprintf( f, "  \"screen\": { \"width\": %d, \"height\": %d },\n", SW, SH );
+     fprintf( f, "  \"pixelformat\": \"%s\",\n", dfb_pixelformat_name( pixelformat ) );
+     fprintf( f, "  \"batch\": %d,\n", batch_size );
+     fprintf( f, "  \"duration\": %d,\n", DEMOTIME );
+     fprintf( f, "  \"iterations\": %d,\n", ITERATIONS );
+     fprintf( f, "  \"warmup\": %d,\n", WARMUP );
+     fprintf( f, "  \"harness_overhead_ns\": %.1f,\n", harness_overhead );
+     if (converge)
+          fprintf( f, "  \"converge\": { \"percent\": %.2f, \"max_time\": %d, \"sample_time\": %d },\n",
+                   converge, MAXTIME, SAMPLETIME );
+     fprintf( f, "  \"flags\": { \"aa\": %s, \"matrix\": %s, \"xor\": %s, \"system\": %s, \"noaccel\": %s },\n",
+              do_aa ? "true" : "false", do_matrix ? "true" : "false", do_xor ? "true" : "false",
+              do_system ? "true" : "false", do_noaccel ? "true" : "false" );
+     fprintf( f, "  \"benchmarks\": [" );
+
+     if (json_sweep) {
+          char   buf[4096];
+          size_t len;
+
+          rewind( json_sweep );
+
+          while ((len = fread( buf, 1, sizeof(buf), json_sweep )) > 0)
+               fwrite( buf, 1, len, f );
+
+          fclose( json_sweep );
+          json_sweep = NULL;
+     }
+     else {
+          write_json_benchmarks( f, NULL, &first );
+     }
+
+     fprintf( f, "\n  ]\n}\n" );
+
+     fclose( f );
 }
 
-static unsigned long long draw_lines_blend( long long t )
+static void write_trace( const char *filename )
 {
-     long i, l, x, y, dx, dy;
-     DFBRegion lines[10];
+     int   i;
+     FILE *f;
+     int   pid = direct_getpid();
 
-     SET_DRAWING_FLAGS( DSDRAW_BLEND );
+     f = fopen( filename, "w" );
+     if (!f) {
+          fprintf( stderr, "Could not open '%s' for writing!\n", filename );
+          return;
+     }
 
-     if (!showAccelerated( DFXL_DRAWLINE, NULL ))
-          return 0;
+     fprintf( f, "{\n  \"displayTimeUnit\": \"ns\",\n  \"traceEvents\": [\n" );
+     fprintf( f, "    { \"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": { \"name\": \"df_dok\" } }",
+              pid );
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          for (l = 0; l < 10; l++) {
-               x  = myrand() % (SW - SX) + SX / 2;
-               y  = myrand() % (SH - SY) + SY / 2;
-               dx = myrand() % (2 * SX) - SX;
-               dy = myrand() % (2 * SY) - SY;
+     for (i = 0; i < num_trace_events; i++) {
+          const TraceEvent *event = &trace_events[i];
 
-               lines[l].x1 = x - dx / 2;
-               lines[l].y1 = y - dy / 2;
-               lines[l].x2 = x + dx / 2;
-               lines[l].y2 = y + dy / 2;
-          }
+          fprintf( f, ",\n    { \"name\": " );
+          json_string( f, event->name );
+          fprintf( f, ", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %lld, \"dur\": %lld, \"pid\": %d, \"tid\": %d",
+                   event->cat, event->ts, event->dur, pid, event->tid );
 
-          dest->SetColor( dest, myrand() & 0xFF, myrand() & 0xFF, myrand() & 0xFF, myrand() % 0x64 );
-          dest->DrawLines( dest, lines, 10 );
+          if (event->calls >= 0)
+               fprintf( f, ", \"args\": { \"calls\": %ld }", event->calls );
+
+          fprintf( f, " }" );
      }
 
-     return 1000 * 10 * (unsigned long long) i;
+     fprintf( f, "\n  ]\n}\n" );
+
+     fclose( f );
 }
 
-static unsigned long long fill_spans_with_flags( long long t, DFBSurfaceDrawingFlags flags )
+/**********************************************************************************************************************/
+
+static inline int rand_range( int range )
 {
-     long    i, r;
-     DFBSpan spans[SY];
+     return range > 0 ? myrand() % range : 0;
+}
 
-     r = SW - SX - 8;
-     if (r > 23)
-          r = 23;
+/* render options of the destination as set by the command line options */
+static DFBSurfaceRenderOptions dest_render_options( void )
+{
+     DFBSurfaceRenderOptions render_options = DSRO_NONE;
 
-     SET_DRAWING_FLAGS( flags );
+     if (do_smooth)
+          render_options |= DSRO_SMOOTH_UPSCALE | DSRO_SMOOTH_DOWNSCALE;
 
-     if (!showAccelerated( DFXL_FILLRECTANGLE, NULL ))
-          return 0;
+     if (do_aa)
+          render_options |= DSRO_ANTIALIAS;
+
+     if (do_matrix)
+          render_options |= DSRO_MATRIX;
+
+     return render_options;
+}
+
+/* move x to the offset from a 64 pixel boundary, staying within 0..max */
+static int align_x( int x, int offset, int max )
+{
+     if (offset < 0)
+          return x;
+
+     x = (x & ~63) + offset;
+
+     while (x > max && x >= 64)
+          x -= 64;
+
+     return MIN( x, MAX( max, 0 ) );
+}
+
+static void bench_prepare( void )
+{
+     int i, l;
+     int r = MIN( SW - SX - 8, 23 );
+
+     for (i = 0; i < BENCH_PARAMS; i++) {
+          BenchParam *p = &bench_params[i];
+
+          p->x  = align_x( rand_range( SW - SX ), bench_align_dst, SW - SX );
+          p->y  = rand_range( SH - SY );
+          p->tx = rand_range( SW - bench_stringwidth );
+          p->ty = rand_range( SH - bench_fontheight );
+          p->sx = align_x( rand_range( SX ), bench_align_src, SX );
+          p->sy = rand_range( SY );
+          p->r  = myrand() & 0xFF;
+          p->g  = myrand() & 0xFF;
+          p->b  = myrand() & 0xFF;
+          p->a  = myrand() % 0x64;
+     }
+
+     for (i = 0; i < BENCH_PARAMS + 10; i++) {
+          int x  = rand_range( SW - SX ) + SX / 2;
+          int y  = rand_range( SH - SY ) + SY / 2;
+          int dx = rand_range( 2 * SX ) - SX;
+          int dy = rand_range( 2 * SY ) - SY;
+
+          bench_rects[i].x = align_x( rand_range( SW - SX ), bench_align_dst, SW - SX );
+          bench_rects[i].y = rand_range( SH - SY );
+          bench_rects[i].w = SX;
+          bench_rects[i].h = SY;
+
+          bench_lines[i].x1 = x - dx / 2;
+          bench_lines[i].y1 = y - dy / 2;
+          bench_lines[i].x2 = x + dx / 2;
+          bench_lines[i].y2 = y + dy / 2;
+
+          bench_traps[i].x1 = rand_range( SW - SX * 3 / 2 ) + SX / 2;
+          bench_traps[i].y1 = rand_range( SH - SY );
+          bench_traps[i].x2 = bench_traps[i].x1 - SX / 2;
+          bench_traps[i].y2 = bench_traps[i].y1 + SY - 1;
+          bench_traps[i].w1 = SX / 2;
+          bench_traps[i].w2 = SX * 3 / 2;
+     }
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          int w = myrand() % r + 2;
-          int x = myrand() % (SW - SX - w * 2) + w;
-          int d = 0;
-          int a = 1;
-          int l;
+     bench_spans = D_REALLOC( bench_spans, BENCH_SPAN_SETS * SY * sizeof(DFBSpan) );
+     if (!bench_spans) {
+          fprintf( stderr, "Out of memory!\n" );
+          exit( 1 );
+     }
+
+     for (i = 0; i < BENCH_SPAN_SETS; i++) {
+          DFBSpan *spans = &bench_spans[i * SY];
+          int      w     = rand_range( r ) + 2;
+          int      x     = rand_range( SW - SX - w * 2 ) + w;
+          int      d     = 0;
+          int      a     = 1;
 
           for (l = 0; l < SY; l++) {
                spans[l].x = x + d;
@@ -855,347 +1869,4633 @@ static unsigned long long fill_spans_with_flags( long long t, DFBSurfaceDrawingF
                else if (d == -w)
                     a = 1;
           }
+     }
 
-          dest->SetColor( dest, myrand() & 0xFF, myrand() & 0xFF, myrand() & 0xFF,
-                          flags & DSDRAW_BLEND ? myrand() % 0x64 : 0xFF );
-          dest->FillSpans( dest, myrand() % (SH - SY), spans, SY );
+     l = BENCH_BATCH_SETS * batch_size;
+
+     bench_batch_srects    = D_REALLOC( bench_batch_srects,    l * sizeof(DFBRectangle) );
+     bench_batch_points    = D_REALLOC( bench_batch_points,    l * sizeof(DFBPoint) );
+     bench_batch_drects    = D_REALLOC( bench_batch_drects,    l * sizeof(DFBRectangle) );
+     bench_batch_triangles = D_REALLOC( bench_batch_triangles, l * sizeof(DFBTriangle) );
+     bench_batch_vertices  = D_REALLOC( bench_batch_vertices,  l * 3 * sizeof(DFBVertex) );
+     if (!bench_batch_srects || !bench_batch_points || !bench_batch_drects ||
+         !bench_batch_triangles || !bench_batch_vertices) {
+          fprintf( stderr, "Out of memory!\n" );
+          exit( 1 );
      }
 
-     return SX * SY * (unsigned long long) i;
+     for (i = 0; i < BENCH_BATCH_SETS; i++)
+          bench_batch_pixels[i] = 0;
+
+     for (i = 0; i < l; i++) {
+          DFBRectangle *drect = &bench_batch_drects[i];
+          DFBTriangle  *tri   = &bench_batch_triangles[i];
+          DFBVertex    *v     = &bench_batch_vertices[i * 3];
+          int           x     = rand_range( SW - SX );
+          int           y     = rand_range( SH - SY );
+
+          bench_batch_srects[i].x = 0;
+          bench_batch_srects[i].y = 0;
+          bench_batch_srects[i].w = SX;
+          bench_batch_srects[i].h = SY;
+
+          bench_batch_points[i].x = x;
+          bench_batch_points[i].y = y;
+
+          /* stretch to between half and one and a half times the size */
+          drect->w = MIN( SX / 2 + rand_range( SX ) + 1, SW );
+          drect->h = MIN( SY / 2 + rand_range( SY ) + 1, SH );
+          drect->x = rand_range( SW - drect->w );
+          drect->y = rand_range( SH - drect->h );
+
+          bench_batch_pixels[i / batch_size] += drect->w * drect->h;
+
+          tri->x1 = x;
+          tri->y1 = y;
+          tri->x2 = x + SX - 1;
+          tri->y2 = y + SY / 2;
+          tri->x3 = x;
+          tri->y3 = y + SY - 1;
+
+          v[0].x = tri->x1; v[0].y = tri->y1; v[0].s = 0; v[0].t = 0;
+          v[1].x = tri->x2; v[1].y = tri->y2; v[1].s = 1; v[1].t = 0.5f;
+          v[2].x = tri->x3; v[2].y = tri->y3; v[2].s = 0; v[2].t = 1;
+          v[0].z = v[1].z = v[2].z = 0;
+          v[0].w = v[1].w = v[2].w = 1;
+     }
 }
 
-static unsigned long long fill_spans( long long t )
-{
-     return fill_spans_with_flags( t, DSDRAW_NOFX );
-}
+/**********************************************************************************************************************/
 
-static unsigned long long fill_spans_blend( long long t )
+/* histogram of the running demo, NULL during warm-up or if latencies are not recorded */
+static __thread LatencyHistogram *latency_hist = NULL;
+static __thread long long         latency_last;
+
+/* fixed number of operations instead of SAMPLETIME, used for verification */
+static __thread long              bench_limit = 0;
+
+/* the clock is read every bench_batch iterations, calibrated to roughly once per millisecond */
+static __thread long              bench_batch;
+static __thread long              bench_next;
+static __thread long long         bench_last;
+
+static bool bench_check( long i, long long t )
 {
-     return fill_spans_with_flags( t, DSDRAW_BLEND );
+     long long now = direct_clock_get_micros();
+
+     /* sub-span of the calls since the previous check */
+     if (trace_calls && trace_filename && i)
+          trace_add( "calls", "calls", bench_last, now, i - bench_next + bench_batch );
+
+     if (!i) {
+          bench_batch = 1;
+     }
+     else {
+          long long elapsed = now - bench_last;
+          long long batch   = elapsed > 0 ? bench_batch * 1000 / elapsed : bench_batch * 16;
+
+          bench_batch = CLAMP( batch, 1, bench_batch * 16 );
+     }
+
+     bench_last = now;
+     bench_next = i + bench_batch;
+
+     return now < (t + bench_excluded + SAMPLETIME) * 1000;
 }
 
-static unsigned long long fill_traps( long long t )
+/*
+ * Loop condition of the benchmarks.
+ * Batches of 'latency_batch' calls are timed if a latency histogram is recorded.
+ */
+static inline bool bench_running( long i, long long t )
 {
-     long i, l;
-     DFBTrapezoid traps[10];
+     bool running;
 
-     SET_DRAWING_FLAGS( DSDRAW_NOFX );
+     if (bench_limit)
+          return i < bench_limit;
 
-     if (!showAccelerated( DFXL_FILLTRAPEZOID, NULL ))
-          return 0;
+     running = (i && i < bench_next) || bench_check( i, t );
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          for (l = 0; l < 10; l++) {
-               traps[l].x1 = (myrand() % (SW - SX * 3 / 2)) + SX / 2;
-               traps[l].y1 = (SH != SY) ? myrand() % (SH - SY) : 0;
-               traps[l].x2 = traps[l].x1 - SX / 2;
-               traps[l].y2 = traps[l].y1 + SY - 1;
-               traps[l].w1 = SX / 2;
-               traps[l].w2 = SX * 3 / 2;
-          }
+     if (latency_hist && !(i % latency_batch)) {
+          long long now = nanos();
+
+          if (i)
+               latency_add( latency_hist, (now - latency_last) / latency_batch );
 
-          dest->SetColor( dest, myrand() & 0xFF, myrand() & 0xFF, myrand() & 0xFF, 0xFF );
-          dest->FillTrapezoids( dest, traps, 10 );
+          latency_last = now;
      }
 
-     return SX * SY * 10 * (unsigned long long) i;
+     return running;
 }
 
-static unsigned long long blit( long long t )
+#define SET_BLITTING_FLAGS(flags) \
+     dest->SetBlittingFlags( dest, (flags) | (do_xor ? DSBLIT_XOR : 0) )
+
+#define SET_DRAWING_FLAGS(flags) \
+     dest->SetDrawingFlags( dest, (flags) | (do_xor ? DSDRAW_XOR : 0) )
+
+static unsigned long long draw_string( long long t )
 {
      long i;
 
-     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+     SET_DRAWING_FLAGS( DSDRAW_NOFX );
 
-     if (!showAccelerated( DFXL_BLIT, simple ))
+     if (!showAccelerated( DFXL_DRAWSTRING, NULL ))
           return 0;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          dest->Blit( dest, simple, NULL, SW != SX ? myrand() % (SW - SX) : 0, SH != SY ? myrand() % (SH - SY) : 0 );
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->SetColor( dest, p->r, p->g, p->b, 0xFF );
+          dest->DrawString( dest, "This is the DirectFB Benchmarking!!!", -1, p->tx, p->ty, DSTF_TOPLEFT );
      }
 
-     return SX * SY * (unsigned long long) i;
+     return 1000 * 36 * (unsigned long long) i;
 }
 
-static unsigned long long blit180( long long t )
+static unsigned long long draw_string_blend( long long t )
 {
      long i;
 
-     SET_BLITTING_FLAGS( DSBLIT_ROTATE180 );
+     SET_DRAWING_FLAGS( DSDRAW_BLEND );
 
-     if (!showAccelerated( DFXL_BLIT, simple ))
+     dest->SetColor( dest, 0x80, 0x80, 0x80, 0x80 );
+
+     if (!showAccelerated( DFXL_DRAWSTRING, NULL ))
           return 0;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          dest->Blit( dest, simple, NULL, SW != SX ? myrand() % (SW - SX) : 0, SH != SY ? myrand() % (SH - SY) : 0 );
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->SetColor( dest, p->r, p->g, p->b, p->a );
+          dest->DrawString( dest, "This is the DirectFB Benchmarking!!!", -1, p->tx, p->ty, DSTF_TOPLEFT );
      }
 
-     return SX * SY * (unsigned long long) i;
+     return 1000 * 36 * (unsigned long long) i;
 }
 
-static unsigned long long blit_colorkeyed( long long t )
+static unsigned long long fill_rect( long long t )
 {
      long i;
 
-     SET_BLITTING_FLAGS( DSBLIT_SRC_COLORKEY );
+     SET_DRAWING_FLAGS( DSDRAW_NOFX );
 
-     if (!showAccelerated( DFXL_BLIT, colorkeyed ))
+     if (!showAccelerated( DFXL_FILLRECTANGLE, NULL ))
           return 0;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          dest->Blit( dest, colorkeyed, NULL, SW != SX ? myrand() % (SW - SX) : 0, SH != SY ? myrand() % (SH - SY) : 0 );
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->SetColor( dest, p->r, p->g, p->b, 0xFF );
+          dest->FillRectangle( dest, p->x, p->y, SX, SY );
      }
 
      return SX * SY * (unsigned long long) i;
 }
 
-static unsigned long long blit_dst_colorkeyed( long long t )
+static unsigned long long fill_rect_blend( long long t )
 {
      long i;
-     DFBRegion clip;
-
-     clip.x1 = 0;
-     clip.x2 = SW - 1;
-     clip.y1 = 0;
-     clip.y2 = SH - 1;
 
-     dest->SetClip( dest, &clip );
-     SET_BLITTING_FLAGS( DSBLIT_NOFX );
-     dest->TileBlit( dest, logo, NULL, 0, 0 );
-     dest->SetClip( dest, NULL );
-
-     SET_BLITTING_FLAGS( DSBLIT_DST_COLORKEY );
-     dest->SetDstColorKey( dest, 0xFF, 0xFF, 0xFF );
+     SET_DRAWING_FLAGS( DSDRAW_BLEND );
 
-     if (!showAccelerated( DFXL_BLIT, simple ))
+     if (!showAccelerated( DFXL_FILLRECTANGLE, NULL ))
           return 0;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          dest->Blit( dest, simple, NULL, SW != SX ? myrand() % (SW - SX) : 0, SH != SY ? myrand() % (SH - SY) : 0 );
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->SetColor( dest, p->r, p->g, p->b, p->a );
+          dest->FillRectangle( dest, p->x, p->y, SX, SY );
      }
 
      return SX * SY * (unsigned long long) i;
 }
 
-static unsigned long long blit_convert( long long t )
+static unsigned long long fill_rects( long long t )
 {
      long i;
 
-     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+     SET_DRAWING_FLAGS( DSDRAW_NOFX );
 
-     if (!showAccelerated( DFXL_BLIT, image32 ))
+     if (!showAccelerated( DFXL_FILLRECTANGLE, NULL ))
           return 0;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          dest->Blit( dest, image32, NULL, SW != SX ? myrand() % (SW - SX) : 0, SH != SY ? myrand() % (SH - SY) : 0 );
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->SetColor( dest, p->r, p->g, p->b, 0xFF );
+          dest->FillRectangles( dest, PARAM_BATCH( bench_rects, i ), 10 );
      }
 
-     return SX * SY * (unsigned long long) i;
+     return SX * SY * 10 * (unsigned long long) i;
 }
 
-static unsigned long long blit_colorize( long long t )
+static unsigned long long fill_rects_blend( long long t )
 {
      long i;
 
-     SET_BLITTING_FLAGS( DSBLIT_COLORIZE );
+     SET_DRAWING_FLAGS( DSDRAW_BLEND );
 
-     if (!showAccelerated( DFXL_BLIT, simple ))
+     if (!showAccelerated( DFXL_FILLRECTANGLE, NULL ))
           return 0;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          dest->SetColor( dest, myrand() & 0xFF, myrand() & 0xFF, myrand() & 0xFF, 0xFF );
-          dest->Blit( dest, simple, NULL, SW != SX ? myrand() % (SW - SX) : 0, SH != SY ? myrand() % (SH - SY) : 0 );
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->SetColor( dest, p->r, p->g, p->b, p->a );
+          dest->FillRectangles( dest, PARAM_BATCH( bench_rects, i ), 10 );
      }
-     return SX * SY * (unsigned long long) i;
+
+     return SX * SY * 10 * (unsigned long long) i;
 }
 
-static unsigned long long blit_mask( long long t )
+static unsigned long long fill_triangle( long long t )
 {
      long i;
 
-     SET_BLITTING_FLAGS( DSBLIT_SRC_MASK_ALPHA | DSBLIT_BLEND_ALPHACHANNEL );
-
-     dest->SetSourceMask( dest, image8a, 0, 0, DSMF_STENCIL );
+     SET_DRAWING_FLAGS( DSDRAW_NOFX );
 
-     if (!showAccelerated( DFXL_BLIT, simple ))
+     if (!showAccelerated( DFXL_FILLTRIANGLE, NULL ))
           return 0;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          DFBRectangle src = { myrand() % SX, myrand() % SY, SX, SY };
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
 
-          dest->Blit( dest, swirl, &src, SW != SX ? myrand() % (SW - SX) : 0, SH != SY ? myrand() % (SH - SY) : 0 );
+          dest->SetColor( dest, p->r, p->g, p->b, 0xFF );
+          dest->FillTriangle( dest, p->x, p->y, p->x + SX - 1, p->y + SY / 2, p->x, p->y + SY - 1 );
      }
 
-     return SX * SY * (unsigned long long) i;
+     return SX * SY * (unsigned long long) i / 2;
 }
 
-static unsigned long long blit_blend( long long t )
+static unsigned long long fill_triangle_blend( long long t )
 {
      long i;
 
-     SET_BLITTING_FLAGS( DSBLIT_BLEND_ALPHACHANNEL );
+     SET_DRAWING_FLAGS( DSDRAW_BLEND );
 
-     if (!showAccelerated( DFXL_BLIT, image32a ))
+     if (!showAccelerated( DFXL_FILLTRIANGLE, NULL ))
           return 0;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          dest->Blit( dest, image32a, NULL, SW != SX ? myrand() % (SW - SX) : 0, SH != SY ? myrand() % (SH - SY) : 0 );
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->SetColor( dest, p->r, p->g, p->b, p->a );
+          dest->FillTriangle( dest, p->x, p->y, p->x + SX - 1, p->y + SY / 2, p->x, p->y + SY - 1 );
      }
 
-     return SX * SY * (unsigned long long) i;
+     return SX * SY * (unsigned long long) i / 2;
 }
 
-static unsigned long long blit_blend_colorize( long long t )
+static unsigned long long fill_triangles( long long t )
 {
      long i;
 
-     SET_BLITTING_FLAGS( DSBLIT_COLORIZE | DSBLIT_BLEND_ALPHACHANNEL );
+     SET_DRAWING_FLAGS( DSDRAW_NOFX );
 
-     if (!showAccelerated( DFXL_BLIT, image32a ))
+     if (!showAccelerated( DFXL_FILLTRIANGLE, NULL ))
           return 0;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          dest->SetColor( dest, myrand() & 0xFF, myrand() & 0xFF, myrand() & 0xFF, 0xFF );
-          dest->Blit( dest, image32a, NULL, SW != SX ? myrand() % (SW - SX) : 0, SH != SY ? myrand() % (SH - SY) : 0 );
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->SetColor( dest, p->r, p->g, p->b, 0xFF );
+          dest->FillTriangles( dest, BATCH( bench_batch_triangles, i ), batch_size );
      }
 
-     return SX * SY * (unsigned long long) i;
+     return SX * SY * (unsigned long long) batch_size * i / 2;
 }
 
-static unsigned long long blit_srcover( long long t )
+static unsigned long long draw_rect( long long t )
 {
      long i;
 
-     SET_BLITTING_FLAGS( DSBLIT_BLEND_ALPHACHANNEL );
-
-     dest->SetPorterDuff( dest, DSPD_SRC_OVER );
+     SET_DRAWING_FLAGS( DSDRAW_NOFX );
 
-     if (!showAccelerated( DFXL_BLIT, rose_pre ))
+     if (!showAccelerated( DFXL_DRAWRECTANGLE, NULL ))
           return 0;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          dest->Blit( dest, rose_pre, NULL, SW != SX ? myrand() % (SW - SX) : 0, SH != SY ? myrand() % (SH - SY) : 0 );
-     }
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
 
-     dest->SetPorterDuff( dest, DSPD_NONE );
+          dest->SetColor( dest, p->r, p->g, p->b, 0xFF );
+          dest->DrawRectangle( dest, p->x, p->y, SX, SY );
+     }
 
-     return SX * SY * (unsigned long long) i;
+     return 1000 * (unsigned long long) i;
 }
 
-static unsigned long long blit_srcover_pre( long long t )
+static unsigned long long draw_rect_blend( long long t )
 {
      long i;
 
-     SET_BLITTING_FLAGS( DSBLIT_BLEND_ALPHACHANNEL | DSBLIT_SRC_PREMULTIPLY );
+     SET_DRAWING_FLAGS( DSDRAW_BLEND );
+
+     if (!showAccelerated( DFXL_DRAWRECTANGLE, NULL ))
+          return 0;
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->SetColor( dest, p->r, p->g, p->b, p->a );
+          dest->DrawRectangle( dest, p->x, p->y, SX, SY );
+     }
+
+     return 1000 * (unsigned long long) i;
+}
+
+static unsigned long long draw_lines( long long t )
+{
+     long i;
+
+     SET_DRAWING_FLAGS( DSDRAW_NOFX );
+
+     if (!showAccelerated( DFXL_DRAWLINE, NULL ))
+          return 0;
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->SetColor( dest, p->r, p->g, p->b, 0xFF );
+          dest->DrawLines( dest, PARAM_BATCH( bench_lines, i ), 10 );
+     }
+
+     return 1000 * 10 * (unsigned long long) i;
+}
+
+static unsigned long long draw_lines_blend( long long t )
+{
+     long i;
+
+     SET_DRAWING_FLAGS( DSDRAW_BLEND );
+
+     if (!showAccelerated( DFXL_DRAWLINE, NULL ))
+          return 0;
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->SetColor( dest, p->r, p->g, p->b, p->a );
+          dest->DrawLines( dest, PARAM_BATCH( bench_lines, i ), 10 );
+     }
+
+     return 1000 * 10 * (unsigned long long) i;
+}
+
+static unsigned long long fill_spans_with_flags( long long t, DFBSurfaceDrawingFlags flags )
+{
+     long i;
+
+     SET_DRAWING_FLAGS( flags );
+
+     if (!showAccelerated( DFXL_FILLRECTANGLE, NULL ))
+          return 0;
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->SetColor( dest, p->r, p->g, p->b, flags & DSDRAW_BLEND ? p->a : 0xFF );
+          dest->FillSpans( dest, p->y, &bench_spans[(i & (BENCH_SPAN_SETS - 1)) * SY], SY );
+     }
+
+     return SX * SY * (unsigned long long) i;
+}
+
+static unsigned long long fill_spans( long long t )
+{
+     return fill_spans_with_flags( t, DSDRAW_NOFX );
+}
+
+static unsigned long long fill_spans_blend( long long t )
+{
+     return fill_spans_with_flags( t, DSDRAW_BLEND );
+}
+
+static unsigned long long fill_traps( long long t )
+{
+     long i;
+
+     SET_DRAWING_FLAGS( DSDRAW_NOFX );
+
+     if (!showAccelerated( DFXL_FILLTRAPEZOID, NULL ))
+          return 0;
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->SetColor( dest, p->r, p->g, p->b, 0xFF );
+          dest->FillTrapezoids( dest, PARAM_BATCH( bench_traps, i ), 10 );
+     }
+
+     return SX * SY * 10 * (unsigned long long) i;
+}
+
+static unsigned long long blit( long long t )
+{
+     long       i;
+     SourceRing ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+
+     if (!showAccelerated( DFXL_BLIT, simple ))
+          return 0;
+
+     ring = source_ring( simple );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->Blit( dest, RING_SOURCE( ring, i ), NULL, p->x, p->y );
+     }
+
+     return SX * SY * (unsigned long long) i;
+}
+
+static unsigned long long blit180( long long t )
+{
+     long       i;
+     SourceRing ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_ROTATE180 );
+
+     if (!showAccelerated( DFXL_BLIT, simple ))
+          return 0;
+
+     ring = source_ring( simple );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->Blit( dest, RING_SOURCE( ring, i ), NULL, p->x, p->y );
+     }
+
+     return SX * SY * (unsigned long long) i;
+}
+
+/* blit with a rotation or flip, opaque from simple or alpha blended from image32a */
+static unsigned long long blit_oriented( long long t, DFBSurfaceBlittingFlags flags, bool blend )
+{
+     long              i;
+     IDirectFBSurface *source  = blend ? image32a : simple;
+     bool              rotated = flags & (DSBLIT_ROTATE90 | DSBLIT_ROTATE270);
+     int               w       = rotated ? SY : SX;
+     int               h       = rotated ? SX : SY;
+     int               range_x = MAX( SW - w, 0 ) + 1;
+     int               range_y = MAX( SH - h, 0 ) + 1;
+     SourceRing        ring;
+
+     SET_BLITTING_FLAGS( flags | (blend ? DSBLIT_BLEND_ALPHACHANNEL : DSBLIT_NOFX) );
+
+     if (!showAccelerated( DFXL_BLIT, source ))
+          return 0;
+
+     ring = source_ring( source );
+
+     /* the output of a rotation is SY x SX, keep it within the destination */
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->Blit( dest, RING_SOURCE( ring, i ), NULL, p->x % range_x, p->y % range_y );
+     }
+
+     return MIN( w, SW ) * MIN( h, SH ) * (unsigned long long) i;
+}
+
+static unsigned long long blit90( long long t )
+{
+     return blit_oriented( t, DSBLIT_ROTATE90, false );
+}
+
+static unsigned long long blit90_blend( long long t )
+{
+     return blit_oriented( t, DSBLIT_ROTATE90, true );
+}
+
+static unsigned long long blit270( long long t )
+{
+     return blit_oriented( t, DSBLIT_ROTATE270, false );
+}
+
+static unsigned long long blit270_blend( long long t )
+{
+     return blit_oriented( t, DSBLIT_ROTATE270, true );
+}
+
+static unsigned long long blit_flip_h( long long t )
+{
+     return blit_oriented( t, DSBLIT_FLIP_HORIZONTAL, false );
+}
+
+static unsigned long long blit_flip_h_blend( long long t )
+{
+     return blit_oriented( t, DSBLIT_FLIP_HORIZONTAL, true );
+}
+
+static unsigned long long blit_flip_v( long long t )
+{
+     return blit_oriented( t, DSBLIT_FLIP_VERTICAL, false );
+}
+
+static unsigned long long blit_flip_v_blend( long long t )
+{
+     return blit_oriented( t, DSBLIT_FLIP_VERTICAL, true );
+}
+
+static unsigned long long blit_colorkeyed( long long t )
+{
+     long       i;
+     SourceRing ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_SRC_COLORKEY );
+
+     if (!showAccelerated( DFXL_BLIT, colorkeyed ))
+          return 0;
+
+     ring = source_ring( colorkeyed );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->Blit( dest, RING_SOURCE( ring, i ), NULL, p->x, p->y );
+     }
+
+     return SX * SY * (unsigned long long) i;
+}
+
+static unsigned long long blit_dst_colorkeyed( long long t )
+{
+     long i;
+     DFBRegion clip;
+     SourceRing ring;
+
+     clip.x1 = 0;
+     clip.x2 = SW - 1;
+     clip.y1 = 0;
+     clip.y2 = SH - 1;
+
+     dest->SetClip( dest, &clip );
+     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+     dest->TileBlit( dest, logo, NULL, 0, 0 );
+     dest->SetClip( dest, NULL );
+
+     SET_BLITTING_FLAGS( DSBLIT_DST_COLORKEY );
+     dest->SetDstColorKey( dest, 0xFF, 0xFF, 0xFF );
+
+     if (!showAccelerated( DFXL_BLIT, simple ))
+          return 0;
+
+     ring = source_ring( simple );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->Blit( dest, RING_SOURCE( ring, i ), NULL, p->x, p->y );
+     }
+
+     return SX * SY * (unsigned long long) i;
+}
+
+static unsigned long long blit_convert( long long t )
+{
+     long       i;
+     SourceRing ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+
+     if (!showAccelerated( DFXL_BLIT, image32 ))
+          return 0;
+
+     ring = source_ring( image32 );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->Blit( dest, RING_SOURCE( ring, i ), NULL, p->x, p->y );
+     }
+
+     return SX * SY * (unsigned long long) i;
+}
+
+static unsigned long long blit_colorize( long long t )
+{
+     long       i;
+     SourceRing ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_COLORIZE );
+
+     if (!showAccelerated( DFXL_BLIT, simple ))
+          return 0;
+
+     ring = source_ring( simple );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->SetColor( dest, p->r, p->g, p->b, 0xFF );
+          dest->Blit( dest, RING_SOURCE( ring, i ), NULL, p->x, p->y );
+     }
+     return SX * SY * (unsigned long long) i;
+}
+
+static unsigned long long blit_mask( long long t )
+{
+     long       i;
+     SourceRing ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_SRC_MASK_ALPHA | DSBLIT_BLEND_ALPHACHANNEL );
+
+     dest->SetSourceMask( dest, image8a, 0, 0, DSMF_STENCIL );
+
+     if (!showAccelerated( DFXL_BLIT, simple ))
+          return 0;
+
+     ring = source_ring( swirl );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p   = PARAM( i );
+          DFBRectangle      src = { p->sx, p->sy, SX, SY };
+
+          dest->Blit( dest, RING_SOURCE( ring, i ), &src, p->x, p->y );
+     }
+
+     return SX * SY * (unsigned long long) i;
+}
+
+static unsigned long long blit_blend( long long t )
+{
+     long       i;
+     SourceRing ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_BLEND_ALPHACHANNEL );
+
+     if (!showAccelerated( DFXL_BLIT, image32a ))
+          return 0;
+
+     ring = source_ring( image32a );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->Blit( dest, RING_SOURCE( ring, i ), NULL, p->x, p->y );
+     }
+
+     return SX * SY * (unsigned long long) i;
+}
+
+static unsigned long long blit_blend_colorize( long long t )
+{
+     long       i;
+     SourceRing ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_COLORIZE | DSBLIT_BLEND_ALPHACHANNEL );
+
+     if (!showAccelerated( DFXL_BLIT, image32a ))
+          return 0;
+
+     ring = source_ring( image32a );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->SetColor( dest, p->r, p->g, p->b, 0xFF );
+          dest->Blit( dest, RING_SOURCE( ring, i ), NULL, p->x, p->y );
+     }
+
+     return SX * SY * (unsigned long long) i;
+}
+
+static unsigned long long blit_srcover( long long t )
+{
+     long       i;
+     SourceRing ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_BLEND_ALPHACHANNEL );
+
+     dest->SetPorterDuff( dest, DSPD_SRC_OVER );
+
+     if (!showAccelerated( DFXL_BLIT, rose_pre ))
+          return 0;
+
+     ring = source_ring( rose_pre );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->Blit( dest, RING_SOURCE( ring, i ), NULL, p->x, p->y );
+     }
+
+     dest->SetPorterDuff( dest, DSPD_NONE );
+
+     return SX * SY * (unsigned long long) i;
+}
+
+static unsigned long long blit_srcover_pre( long long t )
+{
+     long       i;
+     SourceRing ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_BLEND_ALPHACHANNEL | DSBLIT_SRC_PREMULTIPLY );
+
+     dest->SetPorterDuff( dest, DSPD_SRC_OVER );
+
+     if (!showAccelerated( DFXL_BLIT, rose ))
+          return 0;
+
+     ring = source_ring( rose );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->Blit( dest, RING_SOURCE( ring, i ), NULL, p->x, p->y );
+     }
+
+     dest->SetPorterDuff( dest, DSPD_NONE );
+
+     return SX * SY * (unsigned long long) i;
+}
+
+static unsigned long long batch_blit( long long t )
+{
+     long       i;
+     SourceRing ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+
+     if (!showAccelerated( DFXL_BLIT, simple ))
+          return 0;
+
+     ring = source_ring( simple );
+
+     for (i = 0; bench_running( i, t ); i++)
+          dest->BatchBlit( dest, RING_SOURCE( ring, i ), BATCH( bench_batch_srects, i ), BATCH( bench_batch_points, i ),
+                           batch_size );
+
+     return SX * SY * (unsigned long long) batch_size * i;
+}
+
+static unsigned long long tile_blit( long long t )
+{
+     long       i;
+     SourceRing ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+
+     if (!showAccelerated( DFXL_BLIT, simple ))
+          return 0;
+
+     ring = source_ring( simple );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->TileBlit( dest, RING_SOURCE( ring, i ), NULL, p->x, p->y );
+     }
+
+     return SW * SH * (unsigned long long) i;
+}
+
+/* blit from offsets within a 2 * SX x 2 * SY source */
+static unsigned long long blit_subrect( long long t )
+{
+     long       i;
+     SourceRing ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+
+     if (!showAccelerated( DFXL_BLIT, swirl ))
+          return 0;
+
+     ring = source_ring( swirl );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p   = PARAM( i );
+          DFBRectangle      src = { p->sx, p->sy, SX, SY };
+
+          dest->Blit( dest, RING_SOURCE( ring, i ), &src, p->x, p->y );
+     }
+
+     return SX * SY * (unsigned long long) i;
+}
+
+/* blit rectangles with odd widths of up to SX, which don't fit vector widths */
+static unsigned long long blit_odd_width( long long t )
+{
+     long               i;
+     unsigned long long pixels = 0;
+     SourceRing         ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+
+     if (!showAccelerated( DFXL_BLIT, simple ))
+          return 0;
+
+     ring = source_ring( simple );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p   = PARAM( i );
+          DFBRectangle      src = { 0, 0, MAX( (SX - 1 - (int) (i & 15) * 2) | 1, 1 ), SY };
+
+          dest->Blit( dest, RING_SOURCE( ring, i ), &src, p->x, p->y );
+
+          pixels += src.w * src.h;
+     }
+
+     return pixels;
+}
+
+static unsigned long long stretch_blit( long long t )
+{
+     long               i, l, n;
+     unsigned long long pixels = 0;
+     SourceRing         ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+
+     if (!showAccelerated( DFXL_STRETCHBLIT, simple ))
+          return 0;
+
+     ring = source_ring( simple );
+
+     for (n = 0, i = 1, l = 10; bench_running( n, t ); n++) {
+          DFBRectangle rect = { SW / 2 - l / 2, SH / 2 - l / 2, l, l };
+
+          dest->StretchBlit( dest, RING_SOURCE( ring, n ), NULL, &rect );
+
+          pixels += rect.w * rect.h;
+
+          /* grow the rectangle by a step that increases after each round */
+          l += i;
+          if (l >= SH) {
+               l = 10;
+
+               if (++i > SH)
+                    i = 10;
+          }
+     }
+
+     return pixels;
+}
+
+static unsigned long long stretch_blit_colorkeyed( long long t )
+{
+     long               i, l, n;
+     unsigned long long pixels = 0;
+     SourceRing         ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_SRC_COLORKEY );
+
+     if (!showAccelerated( DFXL_STRETCHBLIT, simple ))
+          return 0;
+
+     ring = source_ring( colorkeyed );
+
+     for (n = 0, i = 1, l = 10; bench_running( n, t ); n++) {
+          DFBRectangle rect = { SW / 2 - l / 2, SH / 2 - l / 2, l, l };
+
+          dest->StretchBlit( dest, RING_SOURCE( ring, n ), NULL, &rect );
+
+          pixels += rect.w * rect.h;
+
+          /* grow the rectangle by a step that increases after each round */
+          l += i;
+          if (l >= SH) {
+               l = 10;
+
+               if (++i > SH)
+                    i = 10;
+          }
+     }
+
+     return pixels;
+}
+
+static unsigned long long batch_stretch_blit( long long t )
+{
+     long               i;
+     unsigned long long pixels = 0;
+     SourceRing         ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+
+     if (!showAccelerated( DFXL_STRETCHBLIT, simple ))
+          return 0;
+
+     ring = source_ring( simple );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          dest->BatchStretchBlit( dest, RING_SOURCE( ring, i ), BATCH( bench_batch_srects, i ),
+                                  BATCH( bench_batch_drects, i ), batch_size );
+
+          pixels += bench_batch_pixels[i & (BENCH_BATCH_SETS - 1)];
+     }
+
+     return pixels;
+}
+
+static unsigned long long texture_triangles( long long t )
+{
+     long       i;
+     SourceRing ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+
+     if (!showAccelerated( DFXL_TEXTRIANGLES, simple ))
+          return 0;
+
+     ring = source_ring( simple );
+
+     for (i = 0; bench_running( i, t ); i++)
+          dest->TextureTriangles( dest, RING_SOURCE( ring, i ),
+                                  &bench_batch_vertices[(i & (BENCH_BATCH_SETS - 1)) * batch_size * 3], NULL,
+                                  batch_size * 3, DTTF_LIST );
+
+     return SX * SY * (unsigned long long) batch_size * i / 2;
+}
+
+/*
+ * State changes and calls with minimal work, the result is in calls per second. State changes alternate between two
+ * values, so that none of them is a no-op.
+ */
+static unsigned long long state_color( long long t )
+{
+     long i;
+
+     bench_calls = 1;
+
+     for (i = 0; bench_running( i, t ); i++)
+          dest->SetColor( dest, (i & 1) ? 0xFF : 0x00, 0x80, 0x80, 0xFF );
+
+     return i;
+}
+
+static unsigned long long state_drawing_flags( long long t )
+{
+     long i;
+
+     bench_calls = 1;
+
+     for (i = 0; bench_running( i, t ); i++)
+          SET_DRAWING_FLAGS( (i & 1) ? DSDRAW_BLEND : DSDRAW_NOFX );
+
+     return i;
+}
+
+static unsigned long long state_blitting_flags( long long t )
+{
+     long i;
+
+     bench_calls = 1;
+
+     for (i = 0; bench_running( i, t ); i++)
+          SET_BLITTING_FLAGS( (i & 1) ? DSBLIT_BLEND_ALPHACHANNEL : DSBLIT_NOFX );
+
+     return i;
+}
+
+static unsigned long long state_porter_duff( long long t )
+{
+     long i;
+
+     bench_calls = 1;
+
+     for (i = 0; bench_running( i, t ); i++)
+          dest->SetPorterDuff( dest, (i & 1) ? DSPD_SRC_OVER : DSPD_NONE );
+
+     dest->SetPorterDuff( dest, DSPD_NONE );
+
+     return i;
+}
+
+static unsigned long long state_src_colorkey( long long t )
+{
+     long i;
+
+     bench_calls = 1;
+
+     for (i = 0; bench_running( i, t ); i++)
+          dest->SetSrcColorKey( dest, (i & 1) ? 0xFF : 0x00, 0x80, 0x80 );
+
+     return i;
+}
+
+static unsigned long long call_fill( long long t )
+{
+     long i;
+
+     bench_calls = 1;
+
+     SET_DRAWING_FLAGS( DSDRAW_NOFX );
+
+     dest->SetColor( dest, 0x80, 0x80, 0x80, 0xFF );
+
+     if (!showAccelerated( DFXL_FILLRECTANGLE, NULL ))
+          return 0;
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->FillRectangle( dest, p->x, p->y, 1, 1 );
+     }
+
+     return i;
+}
+
+static unsigned long long call_blit( long long t )
+{
+     long               i;
+     const DFBRectangle rect = { 0, 0, 1, 1 };
+
+     bench_calls = 1;
+
+     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+
+     if (!showAccelerated( DFXL_BLIT, simple ))
+          return 0;
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->Blit( dest, simple, &rect, p->x, p->y );
+     }
+
+     return i;
+}
+
+/* drawing and blitting without state changes in between */
+static unsigned long long call_fill_blit( long long t )
+{
+     long               i;
+     const DFBRectangle rect = { 0, 0, 1, 1 };
+
+     bench_calls = 2;
+
+     SET_DRAWING_FLAGS( DSDRAW_NOFX );
+     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+
+     dest->SetColor( dest, 0x80, 0x80, 0x80, 0xFF );
+
+     if (!showAccelerated( DFXL_FILLRECTANGLE | DFXL_BLIT, simple ))
+          return 0;
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->FillRectangle( dest, p->x, p->y, 1, 1 );
+          dest->Blit( dest, simple, &rect, p->x, p->y );
+     }
+
+     return 2 * (unsigned long long) i;
+}
+
+/* like UI code setting the complete state before every operation */
+static unsigned long long call_alternating( long long t )
+{
+     long               i;
+     const DFBRectangle rect = { 0, 0, 1, 1 };
+
+     bench_calls = 6;
+
+     if (!showAccelerated( DFXL_FILLRECTANGLE | DFXL_BLIT, image32a ))
+          return 0;
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          SET_DRAWING_FLAGS( (i & 1) ? DSDRAW_BLEND : DSDRAW_NOFX );
+          dest->SetColor( dest, p->r, p->g, p->b, p->a );
+          dest->FillRectangle( dest, p->x, p->y, 1, 1 );
+
+          SET_BLITTING_FLAGS( (i & 1) ? DSBLIT_BLEND_ALPHACHANNEL : DSBLIT_NOFX );
+          dest->SetPorterDuff( dest, (i & 1) ? DSPD_SRC_OVER : DSPD_NONE );
+          dest->Blit( dest, image32a, &rect, p->x, p->y );
+     }
+
+     dest->SetPorterDuff( dest, DSPD_NONE );
+
+     return 6 * (unsigned long long) i;
+}
+
+/* append the time per call, also without the harness overhead per loop iteration, to the result line */
+static void calls_print( const Demo *demo )
+{
+     double ns;
+
+     if (!demo->result || strcmp( demo->unit, "MCalls/sec" ))
+          return;
+
+     ns = 1000000.0 / demo->result;
+
+     printf( output_csv ? ",%.2f,%.2f" : "\n     time/call (nsecs) %.2f  without harness %.2f",
+             ns, MAX( ns - harness_overhead / bench_calls, 0 ) );
+}
+
+/* frame times of the frame based benchmarks, accumulated over all threads */
+static LatencyHistogram   frame_times;
+static unsigned long long frame_calls;
+
+static void frame_times_reset( void )
+{
+     memset( &frame_times, 0, sizeof(frame_times) );
+
+     frame_calls = 0;
+}
+
+/* add the frame times and the number of calls issued by a thread */
+static void frame_times_merge( const LatencyHistogram *hist, unsigned long long calls )
+{
+     int i;
+
+     for (i = 0; i < LATENCY_BUCKETS; i++) {
+          if (hist->buckets[i])
+               __sync_fetch_and_add( &frame_times.buckets[i], hist->buckets[i] );
+     }
+
+     __sync_fetch_and_add( &frame_times.count, hist->count );
+     __sync_fetch_and_add( &frame_calls, calls );
+
+     while (frame_times.max < hist->max)
+          __sync_bool_compare_and_swap( &frame_times.max, frame_times.max, hist->max );
+}
+
+/* append frame time percentiles and the number of calls per frame to the result line */
+static void frame_times_print( void )
+{
+     const LatencyHistogram *hist = &frame_times;
+
+     if (!hist->count)
+          return;
+
+     printf( output_csv ? ",%.3f,%.3f,%.3f,%.3f,%.1f" :
+             "\n     frame (usecs) p50 %.3f  p90 %.3f  p99 %.3f  max %.3f  calls/frame %.1f",
+             latency_percentile( hist, 50 ) / 1000, latency_percentile( hist, 90 ) / 1000,
+             latency_percentile( hist, 99 ) / 1000, hist->max / 1000.0, (double) frame_calls / hist->count );
+}
+
+#define UI_ICONS 32
+
+/*
+ * Compose a typical menu screen each frame: a full screen background, translucent panels, a grid of alpha blended
+ * icons with text labels and a colorized highlight of the selected icon. Each frame is completed before the next
+ * one is issued to measure its time, the result is in frames per second.
+ */
+static unsigned long long ui_frame( long long t )
+{
+     long               i;
+     int                n, cols, rows, cell, icon;
+     int                width  = ui_width  > 0 ? MIN( ui_width,  SW ) : SW;
+     int                height = ui_height > 0 ? MIN( ui_height, SH ) : SH;
+     DFBRegion          clip   = { 0, 0, width - 1, height - 1 };
+     long long          ns, now;
+     char               buf[64];
+     unsigned long long calls = 0;
+     LatencyHistogram  *hist;
+     DFBRectangle       rect;
+
+     if (!showAccelerated( DFXL_BLIT, image32a ))
+          return 0;
+
+     hist = D_CALLOC( 1, sizeof(LatencyHistogram) );
+     if (!hist)
+          return 0;
+
+     /* icon grid below a header bar and above a footer bar */
+     cols = 8;
+     rows = UI_ICONS / cols;
+     cell = MIN( width / (cols + 1), (height - 4 * bench_fontheight) / (rows + 1) );
+     icon = MAX( MIN( MIN( cell - bench_fontheight, SX ), SY ), 1 );
+
+     rect.x = 0;
+     rect.y = 0;
+     rect.w = icon;
+     rect.h = icon;
+
+     /* the background is tiled up to the target resolution */
+     dest->SetClip( dest, &clip );
+
+     ns = nanos();
+
+     for (i = 0; bench_running( i, t ); i++) {
+          int selected = i % UI_ICONS;
+
+          /* background */
+          SET_BLITTING_FLAGS( DSBLIT_NOFX );
+          dest->TileBlit( dest, swirl, NULL, 0, 0 );
+
+          /* header, footer and side panel */
+          SET_DRAWING_FLAGS( DSDRAW_BLEND );
+          dest->SetColor( dest, 0x10, 0x20, 0x40, 0xC0 );
+          dest->FillRectangle( dest, 0, 0, width, 2 * bench_fontheight );
+          dest->FillRectangle( dest, 0, height - 2 * bench_fontheight, width, 2 * bench_fontheight );
+          dest->SetColor( dest, 0x00, 0x00, 0x00, 0x60 );
+          dest->FillRectangle( dest, width - cell / 2, 2 * bench_fontheight, cell / 2, height - 4 * bench_fontheight );
+
+          SET_DRAWING_FLAGS( DSDRAW_NOFX );
+          dest->SetColor( dest, 0xFF, 0xFF, 0xFF, 0xFF );
+          dest->DrawString( dest, "DirectFB Benchmarking", -1, bench_fontheight / 2, bench_fontheight / 2,
+                            DSTF_TOPLEFT );
+
+          calls += 11;
+
+          /* icons with labels, alternating straight and premultiplied alpha */
+          for (n = 0; n < UI_ICONS; n++) {
+               int x = cell / 2 + (n % cols) * cell;
+               int y = 2 * bench_fontheight + cell / 2 + (n / cols) * cell;
+
+               if (n & 1) {
+                    SET_BLITTING_FLAGS( DSBLIT_BLEND_ALPHACHANNEL );
+                    dest->SetPorterDuff( dest, DSPD_SRC_OVER );
+                    dest->Blit( dest, rose_pre, &rect, x, y );
+                    dest->SetPorterDuff( dest, DSPD_NONE );
+               }
+               else {
+                    SET_BLITTING_FLAGS( DSBLIT_BLEND_ALPHACHANNEL );
+                    dest->Blit( dest, image32a, &rect, x, y );
+               }
+
+               dest->SetColor( dest, 0xE0, 0xE0, 0xE0, 0xFF );
+               dest->DrawString( dest, n == selected ? "Selected" : "Item", -1, x + icon / 2, y + icon,
+                                 DSTF_TOPCENTER );
+
+               calls += (n & 1) ? 6 : 4;
+          }
+
+          /* highlight */
+          SET_BLITTING_FLAGS( DSBLIT_COLORIZE | DSBLIT_BLEND_ALPHACHANNEL );
+          dest->SetColor( dest, 0xFF, 0xC0, 0x40, 0xFF );
+          dest->Blit( dest, image32a, &rect, cell / 2 + (selected % cols) * cell,
+                      2 * bench_fontheight + cell / 2 + (selected / cols) * cell );
+
+          calls += 3;
+
+          dfb->WaitIdle( dfb );
+
+          now = nanos();
+          latency_add( hist, now - ns );
+          ns = now;
+     }
+
+     dest->SetClip( dest, NULL );
+
+     frame_times_merge( hist, calls );
+
+     i = hist->count;
+
+     D_FREE( hist );
+
+     if (!bench_worker && !bench_limit && !strchr( current_demo->desc, '(' )) {
+          snprintf( buf, sizeof(buf), " (%dx%d)", width, height );
+
+          strcat( current_demo->desc, buf );
+     }
+
+     return i * 1000000ULL;
+}
+
+/**********************************************************************************************************************/
+
+/* blend factors set by SetPorterDuff() */
+typedef enum {
+     PD_ZERO,
+     PD_ONE,
+     PD_SRC_ALPHA,
+     PD_INV_SRC_ALPHA,
+     PD_DST_ALPHA,
+     PD_INV_DST_ALPHA
+} PorterDuffFactor;
+
+typedef struct {
+     DFBSurfacePorterDuffRule  rule;
+     const char               *name;
+     const char               *option;
+     PorterDuffFactor          src;
+     PorterDuffFactor          dst;
+} PorterDuffRule;
+
+static const PorterDuffRule porter_duff_rules[] = {
+     { DSPD_NONE,     "NONE",     "none",     PD_SRC_ALPHA,     PD_INV_SRC_ALPHA },
+     { DSPD_CLEAR,    "CLEAR",    "clear",    PD_ZERO,          PD_ZERO          },
+     { DSPD_SRC,      "SRC",      "src",      PD_ONE,           PD_ZERO          },
+     { DSPD_SRC_OVER, "SRC_OVER", "src-over", PD_ONE,           PD_INV_SRC_ALPHA },
+     { DSPD_DST_OVER, "DST_OVER", "dst-over", PD_INV_DST_ALPHA, PD_ONE           },
+     { DSPD_SRC_IN,   "SRC_IN",   "src-in",   PD_DST_ALPHA,     PD_ZERO          },
+     { DSPD_DST_IN,   "DST_IN",   "dst-in",   PD_ZERO,          PD_SRC_ALPHA     },
+     { DSPD_SRC_OUT,  "SRC_OUT",  "src-out",  PD_INV_DST_ALPHA, PD_ZERO          },
+     { DSPD_DST_OUT,  "DST_OUT",  "dst-out",  PD_ZERO,          PD_INV_SRC_ALPHA },
+     { DSPD_SRC_ATOP, "SRC_ATOP", "src-atop", PD_DST_ALPHA,     PD_INV_SRC_ALPHA },
+     { DSPD_DST_ATOP, "DST_ATOP", "dst-atop", PD_INV_DST_ALPHA, PD_SRC_ALPHA     },
+     { DSPD_ADD,      "ADD",      "add",      PD_ONE,           PD_ONE           },
+     { DSPD_XOR,      "XOR",      "xor",      PD_INV_DST_ALPHA, PD_INV_SRC_ALPHA },
+     { DSPD_DST,      "DST",      "dst",      PD_ZERO,          PD_ONE           },
+};
+
+/* flag in the parameter of the generated demos, the lower bits are the index of the rule */
+#define PD_PREMULTIPLIED 0x100
+
+/* size of the area compared against the reference */
+#define PD_CHECK_SIZE    16
+
+static char porter_duff_options[D_ARRAY_SIZE(porter_duff_rules) * 2][32];
+
+/* blend a straight source onto the destination, premultiplied by the blitting flags, or a premultiplied source */
+static unsigned long long blit_porter_duff( long long t )
+{
+     long                  i;
+     const PorterDuffRule *rule   = &porter_duff_rules[current_demo->param & 0xFF];
+     bool                  pre    = current_demo->param & PD_PREMULTIPLIED;
+     IDirectFBSurface     *source = pre ? rose_pre : rose;
+     SourceRing            ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_BLEND_ALPHACHANNEL | (pre ? 0 : DSBLIT_SRC_PREMULTIPLY) );
+
+     dest->SetPorterDuff( dest, rule->rule );
+
+     if (!showAccelerated( DFXL_BLIT, source )) {
+          dest->SetPorterDuff( dest, DSPD_NONE );
+          return 0;
+     }
+
+     ring = source_ring( source );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          dest->Blit( dest, RING_SOURCE( ring, i ), NULL, p->x, p->y );
+     }
+
+     dest->SetPorterDuff( dest, DSPD_NONE );
+
+     return SX * SY * (unsigned long long) i;
+}
+
+static u32 porter_duff_read( DFBSurfacePixelFormat format, const u8 *p )
+{
+     u16 rgb16;
+
+     switch (format) {
+          case DSPF_ARGB:
+               return *(const u32*) p;
+
+          case DSPF_RGB32:
+               return *(const u32*) p | 0xFF000000;
+
+          case DSPF_RGB16:
+               rgb16 = *(const u16*) p;
+
+               return 0xFF000000 |
+                      ((rgb16 & 0xF800) << 8) | ((rgb16 & 0xE000) << 3) |
+                      ((rgb16 & 0x07E0) << 5) | ((rgb16 & 0x0600) >> 1) |
+                      ((rgb16 & 0x001F) << 3) | ((rgb16 & 0x001C) >> 2);
+
+          case DSPF_A8:
+               return (*p << 24) | 0xFFFFFF;
+
+          default:
+               return 0;
+     }
+}
+
+static void porter_duff_write( DFBSurfacePixelFormat format, u8 *p, u32 argb )
+{
+     switch (format) {
+          case DSPF_ARGB:
+          case DSPF_RGB32:
+               *(u32*) p = argb;
+               break;
+
+          case DSPF_RGB16:
+               *(u16*) p = ((argb >> 8) & 0xF800) | ((argb >> 5) & 0x07E0) | ((argb >> 3) & 0x001F);
+               break;
+
+          case DSPF_A8:
+               *p = argb >> 24;
+               break;
+
+          default:
+               break;
+     }
+}
+
+static int porter_duff_factor( PorterDuffFactor factor, int src_alpha, int dst_alpha )
+{
+     switch (factor) {
+          case PD_ONE:           return 255;
+          case PD_SRC_ALPHA:     return src_alpha;
+          case PD_INV_SRC_ALPHA: return 255 - src_alpha;
+          case PD_DST_ALPHA:     return dst_alpha;
+          case PD_INV_DST_ALPHA: return 255 - dst_alpha;
+          default:               return 0;
+     }
+}
+
+/*
+ * Blit a set of source pixels covering the whole range of alpha onto a set of destination pixels and compare the
+ * result with a plain C implementation of the blend. The tolerance allows for rounding and the channel depth.
+ */
+static void porter_duff_check( Demo *demo )
+{
+     int                    x, y, c, pitch;
+     void                  *data;
+     u8                    *ptr;
+     u32                    src[PD_CHECK_SIZE][PD_CHECK_SIZE];
+     u32                    dst[PD_CHECK_SIZE][PD_CHECK_SIZE];
+     int                    bits[4] = { 8, 8, 8, 8 };
+     DFBSurfaceDescription  sdsc;
+     DFBSurfacePixelFormat  format;
+     IDirectFBSurface      *source;
+     IDirectFBSurface      *target;
+     const PorterDuffRule  *rule = &porter_duff_rules[demo->param & 0xFF];
+     bool                   pre  = demo->param & PD_PREMULTIPLIED;
+
+     dest->GetPixelFormat( dest, &format );
+
+     /* compared channels as blue, green, red, alpha */
+     switch (format) {
+          case DSPF_ARGB:
+               break;
+
+          case DSPF_RGB32:
+               bits[3] = 0;
+               break;
+
+          case DSPF_RGB16:
+               bits[0] = 5; bits[1] = 6; bits[2] = 5; bits[3] = 0;
+               break;
+
+          case DSPF_A8:
+               bits[0] = bits[1] = bits[2] = 0;
+               break;
+
+          default:
+               demo->verify = VERIFY_NONE;
+               return;
+     }
+
+     sdsc.flags       = DSDESC_WIDTH | DSDESC_HEIGHT | DSDESC_PIXELFORMAT | DSDESC_CAPS;
+     sdsc.width       = PD_CHECK_SIZE;
+     sdsc.height      = PD_CHECK_SIZE;
+     sdsc.pixelformat = DSPF_ARGB;
+     sdsc.caps        = (do_system ? DSCAPS_SYSTEMONLY : DSCAPS_NONE) | (pre ? DSCAPS_PREMULTIPLIED : DSCAPS_NONE);
+
+     DFBCHECK(dfb->CreateSurface( dfb, &sdsc, &source ));
+
+     sdsc.pixelformat = format;
+     sdsc.caps        = do_system ? DSCAPS_SYSTEMONLY : DSCAPS_NONE;
+
+     DFBCHECK(dfb->CreateSurface( dfb, &sdsc, &target ));
+
+     if (do_noaccel)
+          target->DisableAcceleration( target, DFXL_ALL );
+
+     /* alpha of the source increases to the right, alpha of the destination to the bottom */
+     DFBCHECK(source->Lock( source, DSLF_WRITE, &data, &pitch ));
+
+     for (y = 0; y < PD_CHECK_SIZE; y++) {
+          for (x = 0; x < PD_CHECK_SIZE; x++) {
+               int a = x * 255 / (PD_CHECK_SIZE - 1);
+               int r = (y * 37 + 200) & 0xFF;
+               int g = (x * 53 + y * 11) & 0xFF;
+               int b = (255 - y * 13) & 0xFF;
+
+               if (pre) {
+                    r = r * a / 255;
+                    g = g * a / 255;
+                    b = b * a / 255;
+               }
+
+               src[y][x] = (a << 24) | (r << 16) | (g << 8) | b;
+
+               ((u32*) ((u8*) data + y * pitch))[x] = src[y][x];
+          }
+     }
+
+     source->Unlock( source );
+
+     DFBCHECK(target->Lock( target, DSLF_WRITE | DSLF_READ, &data, &pitch ));
+
+     for (y = 0; y < PD_CHECK_SIZE; y++) {
+          ptr = (u8*) data + y * pitch;
+
+          for (x = 0; x < PD_CHECK_SIZE; x++) {
+               u32 argb = ((y * 255 / (PD_CHECK_SIZE - 1)) << 24) | ((x * 29 + 64) & 0xFF) << 16 |
+                          ((y * 41 + x * 7) & 0xFF) << 8 | ((x * 17 + 128) & 0xFF);
+
+               porter_duff_write( format, ptr + x * DFB_BYTES_PER_PIXEL( format ), argb );
+
+               /* the destination as stored in the format */
+               dst[y][x] = porter_duff_read( format, ptr + x * DFB_BYTES_PER_PIXEL( format ) );
+          }
+     }
+
+     target->Unlock( target );
+
+     target->SetBlittingFlags( target, DSBLIT_BLEND_ALPHACHANNEL | (pre ? 0 : DSBLIT_SRC_PREMULTIPLY) );
+     target->SetPorterDuff( target, rule->rule );
+     target->Blit( target, source, NULL, 0, 0 );
+
+     demo->verify = VERIFY_OK;
+
+     DFBCHECK(target->Lock( target, DSLF_READ, &data, &pitch ));
+
+     for (y = 0; y < PD_CHECK_SIZE && demo->verify == VERIFY_OK; y++) {
+          ptr = (u8*) data + y * pitch;
+
+          for (x = 0; x < PD_CHECK_SIZE; x++) {
+               u32 s        = src[y][x];
+               u32 d        = dst[y][x];
+               u32 result   = porter_duff_read( format, ptr + x * DFB_BYTES_PER_PIXEL( format ) );
+               u32 expected = 0;
+               int sa       = s >> 24;
+               int da       = d >> 24;
+               int fs       = porter_duff_factor( rule->src, sa, da );
+               int fd       = porter_duff_factor( rule->dst, sa, da );
+
+               for (c = 0; c < 4; c++) {
+                    int sc = (s >> (c * 8)) & 0xFF;
+                    int dc = (d >> (c * 8)) & 0xFF;
+                    int rc = (result >> (c * 8)) & 0xFF;
+                    int ec;
+
+                    if (!pre && c < 3)
+                         sc = sc * sa / 255;
+
+                    ec = MIN( (sc * fs + dc * fd + 127) / 255, 255 );
+
+                    expected |= ec << (c * 8);
+
+                    if (bits[c] && abs( rc - ec ) > 3 + (256 >> bits[c]))
+                         demo->verify = VERIFY_FAILED;
+               }
+
+               if (demo->verify != VERIFY_OK) {
+                    fprintf( stderr, "%s: pixel %d,%d of %s is 0x%08x instead of 0x%08x!\n", demo->desc, x, y,
+                             dfb_pixelformat_name( format ), result, expected );
+                    break;
+               }
+          }
+     }
+
+     target->Unlock( target );
+
+     target->Release( target );
+     source->Release( source );
+}
+
+/* make room for num demos after the current ones, cleared */
+static void grow_demos( int num )
+{
+     Demo *list;
+
+     list = D_MALLOC( (num_demos + num) * sizeof(Demo) );
+     if (!list) {
+          fprintf( stderr, "Out of memory!\n" );
+          exit( 1 );
+     }
+
+     memcpy( list, demos, num_demos * sizeof(Demo) );
+     memset( list + num_demos, 0, num * sizeof(Demo) );
+
+     if (demos != builtin_demos)
+          D_FREE( demos );
+
+     demos = list;
+}
+
+/* add a demo for each Porter-Duff rule with a straight and with a premultiplied source */
+static void add_porter_duff_demos( void )
+{
+     int i;
+     int num = D_ARRAY_SIZE(porter_duff_rules) * 2;
+
+     grow_demos( num );
+
+     for (i = 0; i < num; i++) {
+          const PorterDuffRule *rule = &porter_duff_rules[i / 2];
+          Demo                 *demo = &demos[num_demos++];
+          bool                  pre  = i & 1;
+
+          snprintf( demo->desc, sizeof(demo->desc), "Porter-Duff %s%s", rule->name, pre ? " premultiplied" : "" );
+          snprintf( porter_duff_options[i], sizeof(porter_duff_options[i]), "porter-duff-%s%s",
+                    rule->option, pre ? "-pre" : "" );
+
+          demo->message = "Blending with Porter-Duff rules!";
+          demo->status  = "Porter-Duff blending";
+          demo->option  = porter_duff_options[i];
+          demo->unit    = "MPixel/sec";
+          demo->func    = blit_porter_duff;
+          demo->param   = (i / 2) | (pre ? PD_PREMULTIPLIED : 0);
+     }
+}
+
+/* scale factors of the stretch benchmarks, output size divided by source size */
+typedef struct {
+     const char *name;
+     const char *option;
+     float       x;
+     float       y;
+} StretchRatio;
+
+static const StretchRatio stretch_ratios[] = {
+     { "0.25x",        "0.25x",    0.25f, 0.25f },
+     { "0.5x",         "0.5x",     0.5f,  0.5f  },
+     { "0.75x",        "0.75x",    0.75f, 0.75f },
+     { "1.5x",         "1.5x",     1.5f,  1.5f  },
+     { "2x",           "2x",       2.0f,  2.0f  },
+     { "4x",           "4x",       4.0f,  4.0f  },
+     { "4:3 to 16:9",  "4-3-16-9", 4.0f / 3.0f, 1.0f }
+};
+
+#define STRETCH_SMOOTH 0x100
+
+static char stretch_options[D_ARRAY_SIZE(stretch_ratios) * 2][32];
+
+/* stretch the source of the ratio to the benchmark size, counting output pixels */
+static unsigned long long stretch_ratio( long long t )
+{
+     long              i;
+     bool              smooth = current_demo->param & STRETCH_SMOOTH;
+     IDirectFBSurface *source = current_demo->source;
+     SourceRing        ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+
+     if (!showAccelerated( DFXL_STRETCHBLIT, source ))
+          return 0;
+
+     ring = source_ring( source );
+
+     dest->SetRenderOptions( dest, smooth ? DSRO_SMOOTH_UPSCALE | DSRO_SMOOTH_DOWNSCALE : DSRO_NONE );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p    = PARAM( i );
+          DFBRectangle      rect = { p->x, p->y, SX, SY };
+
+          dest->StretchBlit( dest, RING_SOURCE( ring, i ), NULL, &rect );
+     }
+
+     dest->SetRenderOptions( dest, dest_render_options() );
+
+     return SX * SY * (unsigned long long) i;
+}
+
+static void stretch_release( Demo *demo );
+
+/* create the source of the demo in the given size and pixelformat from the swirl image */
+static bool stretch_source_create( Demo *demo, int width, int height, DFBSurfacePixelFormat format )
+{
+     DFBResult              ret;
+     DFBSurfaceDescription  sdsc;
+
+     stretch_release( demo );
+
+     sdsc.flags       = DSDESC_WIDTH | DSDESC_HEIGHT | DSDESC_PIXELFORMAT;
+     sdsc.width       = width;
+     sdsc.height      = height;
+     sdsc.pixelformat = format;
+
+     ret = dfb->CreateSurface( dfb, &sdsc, &demo->source );
+     if (ret) {
+          fprintf( stderr, "%s: could not create the %dx%d source (%s)!\n",
+                   demo->desc, sdsc.width, sdsc.height, DirectFBErrorString( ret ) );
+          return false;
+     }
+
+     demo->source->SetBlittingFlags( demo->source, DSBLIT_NOFX );
+     demo->source->StretchBlit( demo->source, swirl, NULL, NULL );
+
+     return true;
+}
+
+/* create the source of the ratio */
+static bool stretch_setup( Demo *demo )
+{
+     const StretchRatio *ratio = &stretch_ratios[demo->param & 0xFF];
+
+     return stretch_source_create( demo, MAX( 1, (int) (SX / ratio->x + 0.5f) ),
+                                   MAX( 1, (int) (SY / ratio->y + 0.5f) ), pixelformat );
+}
+
+static void stretch_release( Demo *demo )
+{
+     if (!demo->source)
+          return;
+
+     /* the cold cache copies are compared by pointer, drop them with their image */
+     if (cold_budget) {
+          direct_mutex_lock( &cold_lock );
+
+          if (cold_ring.image == demo->source)
+               cold_release();
+
+          direct_mutex_unlock( &cold_lock );
+     }
+
+     demo->source->Release( demo->source );
+     demo->source = NULL;
+}
+
+/* add a demo for each stretch ratio with nearest and with smooth scaling */
+static void add_stretch_demos( void )
+{
+     int i;
+     int num = D_ARRAY_SIZE(stretch_ratios) * 2;
+
+     grow_demos( num );
+
+     for (i = 0; i < num; i++) {
+          const StretchRatio *ratio  = &stretch_ratios[i / 2];
+          Demo               *demo   = &demos[num_demos++];
+          bool                smooth = i & 1;
+
+          snprintf( demo->desc, sizeof(demo->desc), "Stretch %s%s", ratio->name, smooth ? " smooth" : "" );
+          snprintf( stretch_options[i], sizeof(stretch_options[i]), "stretch-%s%s",
+                    ratio->option, smooth ? "-smooth" : "" );
+
+          demo->message = "Stretching by fixed ratios!";
+          demo->status  = "Stretch ratio";
+          demo->option  = stretch_options[i];
+          demo->unit    = "MPixel/sec";
+          demo->func    = stretch_ratio;
+          demo->param   = (i / 2) | (smooth ? STRETCH_SMOOTH : 0);
+     }
+}
+
+/* video formats converted to the destination by the YUV benchmarks */
+typedef struct {
+     const char            *name;
+     const char            *option;
+     DFBSurfacePixelFormat  format;
+} YUVFormat;
+
+static const YUVFormat yuv_formats[] = {
+     { "YUY2", "yuy2", DSPF_YUY2 },
+     { "UYVY", "uyvy", DSPF_UYVY },
+     { "NV12", "nv12", DSPF_NV12 },
+     { "NV21", "nv21", DSPF_NV21 },
+     { "I420", "i420", DSPF_I420 }
+};
+
+/* conversion only, upscaling from half and downscaling from double the benchmark size */
+typedef enum {
+     YUV_BLIT,
+     YUV_UP,
+     YUV_DOWN,
+     YUV_VARIANTS
+} YUVVariant;
+
+static const char *yuv_variant_names[YUV_VARIANTS]   = { "", " 2x", " 0.5x" };
+static const char *yuv_variant_options[YUV_VARIANTS] = { "", "-up", "-down" };
+
+static char yuv_options[D_ARRAY_SIZE(yuv_formats) * YUV_VARIANTS][32];
+
+/* blit or stretch the video source to the benchmark size, counting output pixels */
+static unsigned long long blit_yuv( long long t )
+{
+     long              i;
+     int               w       = SX;
+     int               h       = SY;
+     bool              stretch = (current_demo->param >> 8) != YUV_BLIT;
+     IDirectFBSurface *source  = current_demo->source;
+     SourceRing        ring;
+
+     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+
+     if (!showAccelerated( stretch ? DFXL_STRETCHBLIT : DFXL_BLIT, source ))
+          return 0;
+
+     ring = source_ring( source );
+
+     /* the source of the conversion only is rounded to even sizes */
+     if (!stretch)
+          source->GetSize( source, &w, &h );
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p    = PARAM( i );
+          DFBRectangle      rect = { p->x, p->y, SX, SY };
+
+          if (stretch)
+               dest->StretchBlit( dest, RING_SOURCE( ring, i ), NULL, &rect );
+          else
+               dest->Blit( dest, RING_SOURCE( ring, i ), NULL, p->x, p->y );
+     }
+
+     return w * h * (unsigned long long) i;
+}
+
+/* create the video source of the variant, in even sizes for the subsampled chroma */
+static bool yuv_setup( Demo *demo )
+{
+     DFBSurfacePixelFormat  format;
+     const YUVFormat       *yuv = &yuv_formats[demo->param & 0xFF];
+     int                    w   = SX;
+     int                    h   = SY;
+
+     dest->GetPixelFormat( dest, &format );
+
+     if (DFB_COLOR_IS_YUV( format )) {
+          fprintf( stderr, "%s: skipped, the destination is not RGB!\n", demo->desc );
+          return false;
+     }
+
+     switch (demo->param >> 8) {
+          case YUV_UP:
+               w /= 2;
+               h /= 2;
+               break;
+
+          case YUV_DOWN:
+               w *= 2;
+               h *= 2;
+               break;
+     }
+
+     return stretch_source_create( demo, MAX( 2, w & ~1 ), MAX( 2, h & ~1 ), yuv->format );
+}
+
+/* add a demo for each video format with conversion only and with scaling */
+static void add_yuv_demos( void )
+{
+     int i;
+     int num = D_ARRAY_SIZE(yuv_formats) * YUV_VARIANTS;
+
+     grow_demos( num );
+
+     for (i = 0; i < num; i++) {
+          const YUVFormat *yuv     = &yuv_formats[i / YUV_VARIANTS];
+          Demo            *demo    = &demos[num_demos++];
+          YUVVariant       variant = i % YUV_VARIANTS;
+
+          snprintf( demo->desc, sizeof(demo->desc), "%s to RGB%s", yuv->name, yuv_variant_names[variant] );
+          snprintf( yuv_options[i], sizeof(yuv_options[i]), "yuv-%s%s", yuv->option, yuv_variant_options[variant] );
+
+          demo->message = "Converting video formats to RGB!";
+          demo->status  = "YUV to RGB";
+          demo->option  = yuv_options[i];
+          demo->unit    = "MPixel/sec";
+          demo->func    = blit_yuv;
+          demo->param   = (i / YUV_VARIANTS) | (variant << 8);
+     }
+}
+
+/* phases of loading an image, accumulated in nanoseconds over all threads */
+typedef enum {
+     LOAD_OPEN,                       /* opening the file into a data buffer */
+     LOAD_PARSE,                      /* probing and header parsing by the image provider */
+     LOAD_ALLOC,                      /* creating the surface */
+     LOAD_RENDER,                     /* decoding and pixel conversion by RenderTo() */
+     LOAD_RELEASE,                    /* releasing provider, buffer and a fresh surface */
+     LOAD_PHASES
+} LoadPhase;
+
+static const char         *load_phase_names[LOAD_PHASES] = { "open", "parse", "alloc", "render", "release" };
+static unsigned long long  load_phases[LOAD_PHASES];
+static unsigned long long  load_count;
+
+static void load_phases_reset( void )
+{
+     memset( load_phases, 0, sizeof(load_phases) );
+
+     load_count = 0;
+}
+
+/* append the average time per image of each phase to the result line */
+static void load_phases_print( void )
+{
+     int i;
+
+     if (!load_count)
+          return;
+
+     if (!output_csv)
+          printf( "\n     phases/image (usecs)" );
+
+     for (i = 0; i < LOAD_PHASES; i++) {
+          if (output_csv)
+               printf( ",%.3f", load_phases[i] / 1000.0 / load_count );
+          else
+               printf( "  %s %.3f", load_phase_names[i], load_phases[i] / 1000.0 / load_count );
+     }
+}
+
+static unsigned long long load_image( long long t )
+{
+     long                    i, loaded;
+     long long               ns, now;
+     DFBSurfaceDescription   dsc;
+     DFBDataBufferDescription ddsc;
+     char                    buf[32];
+     IDirectFBDataBuffer    *buffer;
+     IDirectFBImageProvider *provider;
+     IDirectFBSurface      **surfaces;
+     unsigned long long      pixels = 0;
+     unsigned long long      phases[LOAD_PHASES] = { 0 };
+
+     if (!num_image_files || accel_only)
+          return 0;
+
+     /* surfaces are allocated when the file is loaded first and reused unless fresh ones are requested */
+     surfaces = D_CALLOC( num_image_files, sizeof(IDirectFBSurface*) );
+     if (!surfaces)
+          return 0;
+
+     ddsc.flags = DBDESC_FILE;
+
+     for (i = 0; bench_running( i, t ); i++) {
+          IDirectFBSurface **surface = &surfaces[i % num_image_files];
+
+          ns = nanos();
+
+          /* open the file */
+          ddsc.file = image_files[i % num_image_files];
+
+          DFBCHECK(dfb->CreateDataBuffer( dfb, &ddsc, &buffer ));
+
+          now = nanos();
+          phases[LOAD_OPEN] += now - ns;
+          ns = now;
+
+          /* create an image provider and retrieve a surface description for the image */
+          DFBCHECK(buffer->CreateImageProvider( buffer, &provider ));
+
+          provider->GetSurfaceDescription( provider, &dsc );
+
+          now = nanos();
+          phases[LOAD_PARSE] += now - ns;
+          ns = now;
+
+          /* use the specified pixelformat */
+          if (pixelformat != DSPF_UNKNOWN)
+               dsc.pixelformat = pixelformat;
+
+          /* create a surface using the description */
+          if (!*surface)
+               DFBCHECK(dfb->CreateSurface( dfb, &dsc, surface ));
+
+          now = nanos();
+          phases[LOAD_ALLOC] += now - ns;
+          ns = now;
+
+          /* render the image to the surface */
+          provider->RenderTo( provider, *surface, NULL );
+
+          now = nanos();
+          phases[LOAD_RENDER] += now - ns;
+          ns = now;
+
+          /* release the provider and the buffer */
+          provider->Release( provider );
+          buffer->Release( buffer );
+
+          if (load_fresh) {
+               (*surface)->Release( *surface );
+               *surface = NULL;
+          }
+
+          phases[LOAD_RELEASE] += nanos() - ns;
+
+          pixels += dsc.width * dsc.height;
+     }
+
+     loaded = i;
+
+     for (i = 0; i < num_image_files; i++) {
+          if (surfaces[i])
+               surfaces[i]->Release( surfaces[i] );
+     }
+
+     D_FREE( surfaces );
+
+     for (i = 0; i < LOAD_PHASES; i++)
+          __sync_fetch_and_add( &load_phases[i], phases[i] );
+
+     __sync_fetch_and_add( &load_count, loaded );
+
+     if (!bench_worker && !bench_limit && !strchr( current_demo->desc, '(' )) {
+          if (num_image_files > 1)
+               snprintf( buf, sizeof(buf), " (%d files)", num_image_files );
+          else
+               snprintf( buf, sizeof(buf), " (%dx%d %s)", dsc.width, dsc.height,
+                         dfb_pixelformat_name( dsc.pixelformat ) );
+
+          strcat( current_demo->desc, buf );
+     }
+
+     return pixels;
+}
+
+static int compare_string( const void *a, const void *b )
+{
+     return strcmp( *(char *const *) a, *(char *const *) b );
+}
+
+static void add_image_file( const char *path )
+{
+     char **files = D_REALLOC( image_files, (num_image_files + 1) * sizeof(char*) );
+
+     if (!files)
+          return;
+
+     image_files = files;
+     image_files[num_image_files++] = D_STRDUP( path );
+}
+
+/* add a file or all files of a directory to the images loaded by the load-image benchmark */
+static void add_image_path( const char *path )
+{
+     DIR           *dir;
+     struct dirent *entry;
+     struct stat    st;
+     int            first = num_image_files;
+
+     if (stat( path, &st ) || !S_ISDIR( st.st_mode )) {
+          add_image_file( path );
+          return;
+     }
+
+     dir = opendir( path );
+     if (!dir) {
+          fprintf( stderr, "Could not open directory '%s'!\n", path );
+          return;
+     }
+
+     while ((entry = readdir( dir )) != NULL) {
+          char file[PATH_MAX];
+
+          if (entry->d_name[0] == '.')
+               continue;
+
+          snprintf( file, sizeof(file), "%s/%s", path, entry->d_name );
+
+          if (!stat( file, &st ) && S_ISREG( st.st_mode ))
+               add_image_file( file );
+     }
+
+     closedir( dir );
+
+     qsort( image_files + first, num_image_files - first, sizeof(char*), compare_string );
+}
+
+/**********************************************************************************************************************/
+
+/* size of the fixed part of the payload of each operation, 0 for arrays of 'replay_element_size' */
+static const u32 replay_payload_size[DFDOK_NUM_OPS] = {
+     [DFDOK_OP_CREATE]                 = sizeof(DFDokRecordCreate),
+     [DFDOK_OP_SUBSURFACE]             = sizeof(DFDokRecordSubSurface),
+     [DFDOK_OP_DATA]                   = sizeof(DFDokRecordData),
+     [DFDOK_OP_CLEAR]                  = sizeof(DFDokRecordColor),
+     [DFDOK_OP_SET_COLOR]              = sizeof(DFDokRecordColor),
+     [DFDOK_OP_SET_SRC_COLORKEY]       = sizeof(DFDokRecordColor),
+     [DFDOK_OP_SET_DST_COLORKEY]       = sizeof(DFDokRecordColor),
+     [DFDOK_OP_SET_DRAWING_FLAGS]      = sizeof(u32),
+     [DFDOK_OP_SET_BLITTING_FLAGS]     = sizeof(u32),
+     [DFDOK_OP_SET_PORTER_DUFF]        = sizeof(u32),
+     [DFDOK_OP_SET_RENDER_OPTIONS]     = sizeof(u32),
+     [DFDOK_OP_SET_CLIP]               = sizeof(DFDokRecordRegion),
+     [DFDOK_OP_DRAW_RECTANGLE]         = sizeof(DFBRectangle),
+     [DFDOK_OP_FILL_SPANS]             = sizeof(s32),
+     [DFDOK_OP_BLIT]                   = sizeof(DFDokRecordBlit),
+     [DFDOK_OP_TILE_BLIT]              = sizeof(DFDokRecordBlit),
+     [DFDOK_OP_STRETCH_BLIT]           = sizeof(DFDokRecordStretchBlit),
+     [DFDOK_OP_BATCH_BLIT]             = sizeof(u32),
+     [DFDOK_OP_BATCH_STRETCH_BLIT]     = sizeof(u32),
+     [DFDOK_OP_FLIP]                   = sizeof(DFDokRecordRegion),
+     [DFDOK_OP_SET_SRC_BLEND_FUNCTION] = sizeof(u32),
+     [DFDOK_OP_SET_DST_BLEND_FUNCTION] = sizeof(u32),
+     [DFDOK_OP_SET_MATRIX]             = 9 * sizeof(s32),
+     [DFDOK_OP_SET_SRC_COLORKEY_INDEX] = sizeof(u32),
+     [DFDOK_OP_SET_DST_COLORKEY_INDEX] = sizeof(u32),
+     [DFDOK_OP_SET_SOURCE_MASK]        = sizeof(DFDokRecordSourceMask),
+};
+
+static const u32 replay_element_size[DFDOK_NUM_OPS] = {
+     [DFDOK_OP_FILL_RECTANGLES]        = sizeof(DFBRectangle),
+     [DFDOK_OP_DRAW_LINES]             = sizeof(DFBRegion),
+     [DFDOK_OP_FILL_TRIANGLES]         = sizeof(DFBTriangle),
+     [DFDOK_OP_FILL_SPANS]             = sizeof(DFBSpan),
+     [DFDOK_OP_FILL_TRAPEZOIDS]        = sizeof(DFBTrapezoid),
+     [DFDOK_OP_BATCH_BLIT]             = sizeof(DFBRectangle) + sizeof(DFBPoint),
+     [DFDOK_OP_BATCH_STRETCH_BLIT]     = 2 * sizeof(DFBRectangle),
+};
+
+static inline const void *replay_payload( const DFDokRecordHeader *header )
+{
+     return header + 1;
+}
+
+/* number of array elements following the fixed part of the payload */
+static inline unsigned int replay_elements( const DFDokRecordHeader *header )
+{
+     return replay_element_size[header->op] ?
+            (header->size - replay_payload_size[header->op]) / replay_element_size[header->op] : 0;
+}
+
+/* read a trace written by df_dok_record_start() and split it into frames at each flip */
+static bool replay_load( const char *filename )
+{
+     FILE   *f;
+     long    size;
+     size_t  offset;
+     u32     version;
+     int     max_frames = 1024;
+
+     f = fopen( filename, "rb" );
+     if (!f) {
+          fprintf( stderr, "Could not open trace '%s'!\n", filename );
+          return false;
+     }
+
+     fseek( f, 0, SEEK_END );
+     size = ftell( f );
+     fseek( f, 0, SEEK_SET );
+
+     replay.data = D_MALLOC( size > 0 ? size : 1 );
+     if (!replay.data || fread( replay.data, size, 1, f ) != 1 || size < 12 ||
+         memcmp( replay.data, DFDOK_RECORD_MAGIC, 8 )) {
+          fprintf( stderr, "Invalid trace '%s'!\n", filename );
+          fclose( f );
+          return false;
+     }
+
+     fclose( f );
+
+     memcpy( &version, replay.data + 8, sizeof(version) );
+     if (version != DFDOK_RECORD_VERSION) {
+          fprintf( stderr, "Unsupported version %u of trace '%s'!\n", version, filename );
+          return false;
+     }
+
+     replay.size = size;
+
+     /* there is always room for the end of the next frame */
+     replay.frames = D_MALLOC( max_frames * sizeof(int) );
+     if (!replay.frames)
+          return false;
+
+     replay.frames[0] = 0;
+
+     /* records start 4 byte aligned after the magic and the version */
+     for (offset = 12; offset + sizeof(DFDokRecordHeader) <= replay.size; ) {
+          const DFDokRecordHeader *header = (const DFDokRecordHeader*) (replay.data + offset);
+
+          if (header->size > replay.size - offset - sizeof(DFDokRecordHeader))
+               break;
+
+          offset += sizeof(DFDokRecordHeader) + ((header->size + 3) & ~3);
+
+          /* skip unknown or truncated operations */
+          if (header->op >= DFDOK_NUM_OPS || header->size < replay_payload_size[header->op])
+               continue;
+
+          if (!(replay.num_records & 1023)) {
+               const DFDokRecordHeader **records = D_REALLOC( replay.records, (replay.num_records + 1024) *
+                                                              sizeof(DFDokRecordHeader*) );
+               if (!records)
+                    return false;
+
+               replay.records = records;
+          }
+
+          if (header->surface >= replay.num_surfaces)
+               replay.num_surfaces = header->surface + 1;
+
+          replay.records[replay.num_records++] = header;
+
+          if (header->op != DFDOK_OP_FLIP)
+               continue;
+
+          replay.frames[++replay.num_frames] = replay.num_records;
+
+          if (replay.num_frames + 1 == max_frames) {
+               int *frames = D_REALLOC( replay.frames, (max_frames + 1024) * sizeof(int) );
+               if (!frames)
+                    return false;
+
+               replay.frames = frames;
+               max_frames   += 1024;
+          }
+     }
+
+     if (!replay.num_records) {
+          fprintf( stderr, "No operations in trace '%s'!\n", filename );
+          return false;
+     }
+
+     /* operations after the last flip make up a frame of their own */
+     if (!replay.num_frames || replay.frames[replay.num_frames] < replay.num_records)
+          replay.frames[++replay.num_frames] = replay.num_records;
+
+     return true;
+}
+
+/* create the surfaces of the trace and upload the recorded content of blit sources */
+static bool replay_setup( void )
+{
+     int                    i;
+     DFBSurfacePixelFormat  screen_format = DSPF_UNKNOWN;
+     DFBSurfacePixelFormat *formats;
+
+     replay.surfaces = D_CALLOC( replay.num_surfaces, sizeof(IDirectFBSurface*) );
+     replay.primary  = D_CALLOC( replay.num_surfaces, sizeof(bool) );
+     if (!replay.surfaces || !replay.primary)
+          return false;
+
+     /* recorded formats of the surfaces */
+     formats = D_CALLOC( replay.num_surfaces, sizeof(DFBSurfacePixelFormat) );
+     if (!formats)
+          return false;
+
+     for (i = 0; i < replay.num_records; i++) {
+          const DFDokRecordHeader *header = replay.records[i];
+
+          if (header->op == DFDOK_OP_CREATE) {
+               const DFDokRecordCreate *create = replay_payload( header );
+
+               if (create->caps & DSCAPS_PRIMARY) {
+                    screen_format = create->format;
+                    break;
+               }
+          }
+     }
+
+     for (i = 0; i < replay.num_records; i++) {
+          const DFDokRecordHeader *header = replay.records[i];
+          int                      id     = header->surface;
+
+          switch (header->op) {
+               case DFDOK_OP_CREATE: {
+                    const DFDokRecordCreate *create = replay_payload( header );
+                    DFBSurfaceDescription    dsc;
+
+                    if (replay.surfaces[id]) {
+                         replay.surfaces[id]->Release( replay.surfaces[id] );
+                         replay.surfaces[id] = NULL;
+                    }
+
+                    formats[id]        = create->format;
+                    replay.primary[id] = create->caps & DSCAPS_PRIMARY;
+                    if (replay.primary[id])
+                         break;
+
+                    /* offscreen buffers in the format of the screen follow the benchmark pixelformat */
+                    dsc.flags       = DSDESC_WIDTH | DSDESC_HEIGHT | DSDESC_PIXELFORMAT | DSDESC_CAPS;
+                    dsc.width       = create->width;
+                    dsc.height      = create->height;
+                    dsc.pixelformat = create->format;
+                    dsc.caps        = create->caps & DSCAPS_PREMULTIPLIED;
+
+                    if (create->format == screen_format && pixelformat != DSPF_UNKNOWN)
+                         dsc.pixelformat = pixelformat;
+
+                    if (do_system)
+                         dsc.caps |= DSCAPS_SYSTEMONLY;
+
+                    if (dfb->CreateSurface( dfb, &dsc, &replay.surfaces[id] )) {
+                         D_FREE( formats );
+                         return false;
+                    }
+
+                    if (do_noaccel)
+                         replay.surfaces[id]->DisableAcceleration( replay.surfaces[id], DFXL_ALL );
+
+                    replay.surfaces[id]->Clear( replay.surfaces[id], 0, 0, 0, 0 );
+                    break;
+               }
+
+               case DFDOK_OP_SUBSURFACE: {
+                    const DFDokRecordSubSurface *sub    = replay_payload( header );
+                    IDirectFBSurface            *parent;
+
+                    if (sub->parent >= (u32) replay.num_surfaces)
+                         break;
+
+                    if (replay.surfaces[id]) {
+                         replay.surfaces[id]->Release( replay.surfaces[id] );
+                         replay.surfaces[id] = NULL;
+                    }
+
+                    formats[id]        = formats[sub->parent];
+                    replay.primary[id] = replay.primary[sub->parent];
+
+                    parent = replay.primary[id] ? dest : replay.surfaces[sub->parent];
+                    if (parent)
+                         parent->GetSubSurface( parent, &sub->rect, &replay.surfaces[id] );
+                    break;
+               }
+
+               case DFDOK_OP_DATA: {
+                    const DFDokRecordData *data    = replay_payload( header );
+                    IDirectFBSurface      *surface = replay.surfaces[id];
+                    IDirectFBSurface      *content;
+                    DFBSurfaceDescription  dsc;
+                    DFBSurfacePixelFormat  format;
+                    int                    width, height;
+
+                    if (!surface || replay.primary[id] || data->pitch <= 0 || data->rows <= 0 ||
+                        header->size - sizeof(*data) < (u64) data->pitch * data->rows)
+                         break;
+
+                    surface->GetSize( surface, &width, &height );
+
+                    /* the data is in the recorded format, which may differ from the one used here */
+                    format = formats[id];
+                    if (!format)
+                         surface->GetPixelFormat( surface, &format );
+
+                    /* the payload must cover the whole surface */
+                    if (data->pitch < DFB_BYTES_PER_LINE( format, width ) ||
+                        data->rows < DFB_PLANE_MULTIPLY( format, height ))
+                         break;
+
+                    dsc.flags                   = DSDESC_WIDTH | DSDESC_HEIGHT | DSDESC_PIXELFORMAT |
+                                                  DSDESC_PREALLOCATED;
+                    dsc.width                   = width;
+                    dsc.height                  = height;
+                    dsc.pixelformat             = format;
+                    dsc.preallocated[0].data    = (void*) (data + 1);
+                    dsc.preallocated[0].pitch   = data->pitch;
+
+                    if (dfb->CreateSurface( dfb, &dsc, &content ))
+                         break;
+
+                    surface->SetBlittingFlags( surface, DSBLIT_NOFX );
+                    surface->Blit( surface, content, NULL, 0, 0 );
+
+                    content->Release( content );
+                    break;
+               }
+
+               default:
+                    break;
+          }
+     }
+
+     D_FREE( formats );
+
+     dfb->WaitIdle( dfb );
+
+     return true;
+}
+
+static void replay_release( void )
+{
+     int i;
+
+     if (replay.surfaces) {
+          for (i = replay.num_surfaces - 1; i >= 0; i--) {
+               if (replay.surfaces[i])
+                    replay.surfaces[i]->Release( replay.surfaces[i] );
+          }
+
+          D_FREE( replay.surfaces );
+          replay.surfaces = NULL;
+     }
+
+     if (replay.primary) {
+          D_FREE( replay.primary );
+          replay.primary = NULL;
+     }
+}
+
+static inline IDirectFBSurface *replay_surface( u32 id )
+{
+     if (id >= (u32) replay.num_surfaces)
+          return NULL;
+
+     /* the primary is replayed on the destination of the calling thread */
+     if (replay.primary[id] && !replay.surfaces[id])
+          return dest;
+
+     return replay.surfaces[id];
+}
+
+/* issue the calls of a frame, returns the number of calls */
+static int replay_frame( int frame )
+{
+     int i;
+
+     for (i = replay.frames[frame]; i < replay.frames[frame+1]; i++) {
+          const DFDokRecordHeader *header  = replay.records[i];
+          const void              *payload = replay_payload( header );
+          IDirectFBSurface        *surface = replay_surface( header->surface );
+          unsigned int             num     = replay_elements( header );
+
+          if (!surface)
+               continue;
+
+          switch (header->op) {
+               case DFDOK_OP_CLEAR: {
+                    const DFDokRecordColor *color = payload;
+
+                    surface->Clear( surface, color->r, color->g, color->b, color->a );
+                    break;
+               }
+
+               case DFDOK_OP_SET_COLOR: {
+                    const DFDokRecordColor *color = payload;
+
+                    surface->SetColor( surface, color->r, color->g, color->b, color->a );
+                    break;
+               }
+
+               case DFDOK_OP_SET_SRC_COLORKEY: {
+                    const DFDokRecordColor *color = payload;
+
+                    surface->SetSrcColorKey( surface, color->r, color->g, color->b );
+                    break;
+               }
+
+               case DFDOK_OP_SET_DST_COLORKEY: {
+                    const DFDokRecordColor *color = payload;
+
+                    surface->SetDstColorKey( surface, color->r, color->g, color->b );
+                    break;
+               }
+
+               case DFDOK_OP_SET_DRAWING_FLAGS:
+                    surface->SetDrawingFlags( surface, *(const u32*) payload );
+                    break;
+
+               case DFDOK_OP_SET_BLITTING_FLAGS:
+                    surface->SetBlittingFlags( surface, *(const u32*) payload );
+                    break;
+
+               case DFDOK_OP_SET_PORTER_DUFF:
+                    surface->SetPorterDuff( surface, *(const u32*) payload );
+                    break;
+
+               case DFDOK_OP_SET_RENDER_OPTIONS:
+                    surface->SetRenderOptions( surface, *(const u32*) payload );
+                    break;
+
+               case DFDOK_OP_SET_SRC_BLEND_FUNCTION:
+                    surface->SetSrcBlendFunction( surface, *(const u32*) payload );
+                    break;
+
+               case DFDOK_OP_SET_DST_BLEND_FUNCTION:
+                    surface->SetDstBlendFunction( surface, *(const u32*) payload );
+                    break;
+
+               case DFDOK_OP_SET_MATRIX:
+                    surface->SetMatrix( surface, payload );
+                    break;
+
+               case DFDOK_OP_SET_SRC_COLORKEY_INDEX:
+                    surface->SetSrcColorKeyIndex( surface, *(const u32*) payload );
+                    break;
+
+               case DFDOK_OP_SET_DST_COLORKEY_INDEX:
+                    surface->SetDstColorKeyIndex( surface, *(const u32*) payload );
+                    break;
+
+               case DFDOK_OP_SET_SOURCE_MASK: {
+                    const DFDokRecordSourceMask *mask = payload;
+
+                    surface->SetSourceMask( surface, replay_surface( mask->mask ), mask->x, mask->y, mask->flags );
+                    break;
+               }
+
+               case DFDOK_OP_SET_CLIP: {
+                    const DFDokRecordRegion *clip = payload;
+
+                    surface->SetClip( surface, clip->valid ? &clip->region : NULL );
+                    break;
+               }
+
+               case DFDOK_OP_FILL_RECTANGLES:
+                    surface->FillRectangles( surface, payload, num );
+                    break;
+
+               case DFDOK_OP_DRAW_RECTANGLE: {
+                    const DFBRectangle *rect = payload;
+
+                    surface->DrawRectangle( surface, rect->x, rect->y, rect->w, rect->h );
+                    break;
+               }
+
+               case DFDOK_OP_DRAW_LINES:
+                    surface->DrawLines( surface, payload, num );
+                    break;
+
+               case DFDOK_OP_FILL_TRIANGLES:
+                    surface->FillTriangles( surface, payload, num );
+                    break;
+
+               case DFDOK_OP_FILL_SPANS:
+                    surface->FillSpans( surface, *(const s32*) payload, (const DFBSpan*) ((const s32*) payload + 1),
+                                        num );
+                    break;
+
+               case DFDOK_OP_FILL_TRAPEZOIDS:
+                    surface->FillTrapezoids( surface, payload, num );
+                    break;
+
+               case DFDOK_OP_BLIT:
+               case DFDOK_OP_TILE_BLIT: {
+                    const DFDokRecordBlit *blit   = payload;
+                    IDirectFBSurface      *source = replay_surface( blit->source );
+
+                    if (!source)
+                         break;
+
+                    if (header->op == DFDOK_OP_BLIT)
+                         surface->Blit( surface, source, blit->valid ? &blit->rect : NULL, blit->x, blit->y );
+                    else
+                         surface->TileBlit( surface, source, blit->valid ? &blit->rect : NULL, blit->x, blit->y );
+                    break;
+               }
+
+               case DFDOK_OP_STRETCH_BLIT: {
+                    const DFDokRecordStretchBlit *blit   = payload;
+                    IDirectFBSurface             *source = replay_surface( blit->source );
+
+                    if (source)
+                         surface->StretchBlit( surface, source, (blit->valid & 1) ? &blit->source_rect : NULL,
+                                               (blit->valid & 2) ? &blit->dest_rect : NULL );
+                    break;
+               }
+
+               case DFDOK_OP_BATCH_BLIT: {
+                    const DFBRectangle *rects  = (const DFBRectangle*) ((const u32*) payload + 1);
+                    IDirectFBSurface   *source = replay_surface( *(const u32*) payload );
+
+                    if (source && num)
+                         surface->BatchBlit( surface, source, rects, (const DFBPoint*) (rects + num), num );
+                    break;
+               }
+
+               case DFDOK_OP_BATCH_STRETCH_BLIT: {
+                    const DFBRectangle *rects  = (const DFBRectangle*) ((const u32*) payload + 1);
+                    IDirectFBSurface   *source = replay_surface( *(const u32*) payload );
+
+                    if (source && num)
+                         surface->BatchStretchBlit( surface, source, rects, rects + num, num );
+                    break;
+               }
+
+               /* surfaces are set up in advance and the frame is not shown */
+               default:
+                    break;
+          }
+     }
+
+     return replay.frames[frame+1] - replay.frames[frame];
+}
+
+/*
+ * Replay the frames of the trace in a loop as fast as possible. Each frame is completed before the next one is
+ * issued to measure its time, the result is in frames per second.
+ */
+static unsigned long long replay_trace( long long t )
+{
+     long               i;
+     long long          ns, now;
+     char               buf[64];
+     unsigned long long calls = 0;
+     LatencyHistogram  *hist;
+
+     if (!replay.surfaces)
+          return 0;
+
+     hist = D_CALLOC( 1, sizeof(LatencyHistogram) );
+     if (!hist)
+          return 0;
+
+     ns = nanos();
+
+     for (i = 0; bench_running( i, t ); i++) {
+          calls += replay_frame( i % replay.num_frames );
+
+          dfb->WaitIdle( dfb );
+
+          now = nanos();
+          latency_add( hist, now - ns );
+          ns = now;
+     }
+
+     frame_times_merge( hist, calls );
+
+     i = hist->count;
+
+     D_FREE( hist );
+
+     if (!bench_worker && !bench_limit && !strchr( current_demo->desc, '(' )) {
+          snprintf( buf, sizeof(buf), " (%d frames, %d surfaces)", replay.num_frames, replay.num_surfaces );
+
+          strcat( current_demo->desc, buf );
+     }
+
+     return i * 1000000ULL;
+}
+
+/**********************************************************************************************************************/
+
+static void plugin_context( DFDokContext *ctx )
+{
+     ctx->dfb           = dfb;
+     ctx->dest          = dest;
+     ctx->width         = SX;
+     ctx->height        = SY;
+     ctx->screen_width  = SW;
+     ctx->screen_height = SH;
+     ctx->pixelformat   = pixelformat;
+     ctx->running       = bench_running;
+     ctx->accelerated   = showAccelerated;
+}
+
+/* benchmark function of all plug-in demos, also called in worker threads with their own destination */
+static unsigned long long plugin_run( long long t )
+{
+     DFDokContext ctx;
+
+     plugin_context( &ctx );
+
+     return current_demo->plugin->run( &ctx, current_demo->plugin_data, t );
+}
+
+static bool demo_setup( Demo *demo )
+{
+     DFBResult    ret;
+     DFDokContext ctx;
+
+     if (demo->func == blit_porter_duff)
+          porter_duff_check( demo );
+
+     if (demo->func == stretch_ratio)
+          return stretch_setup( demo );
+
+     if (demo->func == blit_yuv)
+          return yuv_setup( demo );
+
+     if (demo->func == replay_trace) {
+          if (replay_setup())
+               return true;
+
+          fprintf( stderr, "%s: could not create the surfaces of the trace!\n", demo->desc );
+          replay_release();
+          return false;
+     }
+
+     if (!demo->plugin || !demo->plugin->setup)
+          return true;
+
+     plugin_context( &ctx );
+
+     demo->plugin_data = NULL;
+
+     ret = demo->plugin->setup( &ctx, &demo->plugin_data );
+     if (ret) {
+          fprintf( stderr, "%s: setup failed (%s)!\n", demo->desc, DirectFBErrorString( ret ) );
+          return false;
+     }
+
+     return true;
+}
+
+static void demo_teardown( Demo *demo )
+{
+     DFDokContext ctx;
+
+     if (demo->func == replay_trace)
+          replay_release();
+
+     if (demo->func == stretch_ratio || demo->func == blit_yuv)
+          stretch_release( demo );
+
+     if (!demo->plugin || !demo->plugin->teardown)
+          return;
+
+     plugin_context( &ctx );
+
+     demo->plugin->teardown( &ctx, demo->plugin_data );
+
+     demo->plugin_data = NULL;
+}
+
+static void add_plugin_demos( const char *name, const DFDokBenchmark *benchmarks, int num )
+{
+     int i, j;
+
+     grow_demos( num );
+
+     for (i = 0; i < num; i++) {
+          const DFDokBenchmark *benchmark = &benchmarks[i];
+          Demo                 *demo      = &demos[num_demos];
+
+          if (!benchmark->option || !benchmark->desc || !benchmark->run) {
+               fprintf( stderr, "%s: incomplete benchmark %d!\n", name, i );
+               continue;
+          }
+
+          for (j = 0; j < num_demos; j++) {
+               if (!strcmp( demos[j].option, benchmark->option ))
+                    break;
+          }
+
+          if (j < num_demos) {
+               fprintf( stderr, "%s: benchmark '%s' already exists!\n", name, benchmark->option );
+               continue;
+          }
+
+          memset( demo, 0, sizeof(Demo) );
+
+          snprintf( demo->desc, sizeof(demo->desc), "%s", benchmark->desc );
+
+          demo->message    = (char*) (benchmark->message ?: benchmark->desc);
+          demo->status     = (char*) (benchmark->status  ?: benchmark->desc);
+          demo->option     = (char*) benchmark->option;
+          demo->unit       = (char*) (benchmark->unit    ?: "KOps/sec");
+          demo->default_on = benchmark->default_on;
+          demo->func       = plugin_run;
+          demo->plugin     = benchmark;
+
+          num_demos++;
+     }
+}
+
+/* load all shared objects of the directory as benchmark plug-ins */
+static void load_plugins( const char *path, bool required )
+{
+#ifdef HAVE_DLOPEN
+     DIR           *dir;
+     struct dirent *entry;
+
+     dir = opendir( path );
+     if (!dir) {
+          /* the default directory only exists if plug-ins have been installed */
+          if (required || errno != ENOENT)
+               fprintf( stderr, "Could not open plug-in directory '%s'!\n", path );
+          return;
+     }
+
+     while ((entry = readdir( dir )) != NULL) {
+          char                  file[PATH_MAX];
+          void                 *handle;
+          void                **handles;
+          DFDokPluginInitFunc   init;
+          const DFDokBenchmark *benchmarks;
+          int                   num = 0;
+          size_t                len = strlen( entry->d_name );
+
+          if (len < 4 || strcmp( entry->d_name + len - 3, ".so" ))
+               continue;
+
+          snprintf( file, sizeof(file), "%s/%s", path, entry->d_name );
+
+          handle = dlopen( file, RTLD_NOW | RTLD_LOCAL );
+          if (!handle) {
+               fprintf( stderr, "Could not load plug-in: %s\n", dlerror() );
+               continue;
+          }
+
+          init = (DFDokPluginInitFunc) dlsym( handle, DF_DOK_PLUGIN_INIT );
+          if (!init) {
+               fprintf( stderr, "%s: missing %s()!\n", file, DF_DOK_PLUGIN_INIT );
+               dlclose( handle );
+               continue;
+          }
+
+          benchmarks = init( DF_DOK_PLUGIN_ABI_VERSION, &num );
+          if (!benchmarks || num < 1) {
+               fprintf( stderr, "%s: no benchmarks for ABI version %d!\n", file, DF_DOK_PLUGIN_ABI_VERSION );
+               dlclose( handle );
+               continue;
+          }
+
+          handles = D_REALLOC( plugin_handles, (num_plugin_handles + 1) * sizeof(void*) );
+          if (!handles) {
+               dlclose( handle );
+               continue;
+          }
+
+          plugin_handles = handles;
+          plugin_handles[num_plugin_handles++] = handle;
+
+          add_plugin_demos( file, benchmarks, num );
+     }
+
+     closedir( dir );
+#else
+     fprintf( stderr, "Plug-ins are not supported on this platform!\n" );
+#endif
+}
+
+/**********************************************************************************************************************/
+
+/* skip a pixelformat in which a test image cannot be created */
+#define IMAGECHECK(x)             \
+     do {                         \
+          ret = x;                \
+          if (ret != DFB_OK)      \
+               goto error;        \
+     } while (0)
+
+/* create the test images in the benchmark size and pixelformat */
+static DFBResult create_images( void )
+{
+     DFBResult                 ret;
+     DFBSurfaceDescription     sdsc;
+     DFBDataBufferDescription  ddsc;
+     IDirectFBDataBuffer      *buffer;
+     IDirectFBImageProvider   *provider;
+     long long                 trace = trace_begin();
+
+     /* create a surface and render an image to it */
+#ifdef USE_IMAGE_HEADERS
+     ddsc.flags         = DBDESC_MEMORY;
+     ddsc.memory.data   = GET_IMAGEDATA( swirl );
+     ddsc.memory.length = GET_IMAGESIZE( swirl );
+#else
+     ddsc.flags         = DBDESC_FILE;
+     ddsc.file          = GET_IMAGEFILE( swirl );
+#endif
+     DFBCHECK(dfb->CreateDataBuffer( dfb, &ddsc, &buffer ));
+     DFBCHECK(buffer->CreateImageProvider( buffer, &provider ));
+     buffer->Release( buffer );
+     provider->GetSurfaceDescription( provider, &sdsc );
+     sdsc.width       = SX * 2;
+     sdsc.height      = SY * 2;
+     sdsc.pixelformat = pixelformat;
+     IMAGECHECK( dfb->CreateSurface( dfb, &sdsc, &swirl ) );
+     IMAGECHECK( provider->RenderTo( provider, swirl, NULL ) );
+     provider->Release( provider );
+
+     /* create a surface and render an image to it */
+#ifdef USE_IMAGE_HEADERS
+     ddsc.flags         = DBDESC_MEMORY;
+     ddsc.memory.data   = GET_IMAGEDATA( rose );
+     ddsc.memory.length = GET_IMAGESIZE( rose );
+#else
+     ddsc.flags         = DBDESC_FILE;
+     ddsc.file          = GET_IMAGEFILE( rose );
+#endif
+     DFBCHECK(dfb->CreateDataBuffer( dfb, &ddsc, &buffer ));
+     DFBCHECK(buffer->CreateImageProvider( buffer, &provider ));
+     buffer->Release( buffer );
+     provider->GetSurfaceDescription( provider, &sdsc );
+     sdsc.width       = SX;
+     sdsc.height      = SY;
+     sdsc.pixelformat = DSPF_ARGB;
+     IMAGECHECK( dfb->CreateSurface( dfb, &sdsc, &rose ) );
+     IMAGECHECK( provider->RenderTo( provider, rose, NULL ) );
+     sdsc.flags      |= DSDESC_CAPS;
+     sdsc.caps        = DSCAPS_PREMULTIPLIED;
+     IMAGECHECK( dfb->CreateSurface( dfb, &sdsc, &rose_pre ) );
+     IMAGECHECK( provider->RenderTo( provider, rose_pre, NULL ) );
+     provider->Release( provider );
+
+     /* create a surface and render an image to it */
+#ifdef USE_IMAGE_HEADERS
+     ddsc.flags         = DBDESC_MEMORY;
+     ddsc.memory.data   = GET_IMAGEDATA( melted );
+     ddsc.memory.length = GET_IMAGESIZE( melted );
+#else
+     ddsc.flags         = DBDESC_FILE;
+     ddsc.file          = GET_IMAGEFILE( melted );
+#endif
+     DFBCHECK(dfb->CreateDataBuffer( dfb, &ddsc, &buffer ));
+     DFBCHECK(buffer->CreateImageProvider( buffer, &provider ));
+     buffer->Release( buffer );
+     provider->GetSurfaceDescription( provider, &sdsc );
+     sdsc.width       = SX;
+     sdsc.height      = SY;
+     sdsc.pixelformat = pixelformat;
+     IMAGECHECK( dfb->CreateSurface( dfb, &sdsc, &simple ) );
+     IMAGECHECK( provider->RenderTo( provider, simple, NULL ) );
+     provider->Release( provider );
+
+     /* create a surface and render an image to it */
+#ifdef USE_IMAGE_HEADERS
+     ddsc.flags         = DBDESC_MEMORY;
+     ddsc.memory.data   = GET_IMAGEDATA( colorkeyed );
+     ddsc.memory.length = GET_IMAGESIZE( colorkeyed );
+#else
+     ddsc.flags         = DBDESC_FILE;
+     ddsc.file          = GET_IMAGEFILE( colorkeyed );
+#endif
+     DFBCHECK(dfb->CreateDataBuffer( dfb, &ddsc, &buffer ));
+     DFBCHECK(buffer->CreateImageProvider( buffer, &provider ));
+     buffer->Release( buffer );
+     provider->GetSurfaceDescription( provider, &sdsc );
+     sdsc.width       = SX;
+     sdsc.height      = SY;
+     sdsc.pixelformat = pixelformat;
+     IMAGECHECK( dfb->CreateSurface( dfb, &sdsc, &colorkeyed ) );
+     IMAGECHECK( provider->RenderTo( provider, colorkeyed, NULL ) );
+     IMAGECHECK( colorkeyed->SetSrcColorKey( colorkeyed, colorkey.r, colorkey.g, colorkey.b ) );
+     provider->Release( provider );
+
+     /* create a surface and render an image to it */
+#ifdef USE_IMAGE_HEADERS
+     ddsc.flags         = DBDESC_MEMORY;
+     ddsc.memory.data   = GET_IMAGEDATA( laden_bike );
+     ddsc.memory.length = GET_IMAGESIZE( laden_bike );
+#else
+     ddsc.flags         = DBDESC_FILE;
+     ddsc.file          = GET_IMAGEFILE( laden_bike );
+#endif
+     DFBCHECK(dfb->CreateDataBuffer( dfb, &ddsc, &buffer ));
+     DFBCHECK(buffer->CreateImageProvider( buffer, &provider ));
+     buffer->Release( buffer );
+     provider->GetSurfaceDescription( provider, &sdsc );
+     sdsc.width       = SX;
+     sdsc.height      = SY;
+     sdsc.pixelformat = DFB_BYTES_PER_PIXEL( pixelformat ) == 2 ? DSPF_RGB32 : DSPF_RGB16;
+     IMAGECHECK( dfb->CreateSurface( dfb, &sdsc, &image32 ) );
+     IMAGECHECK( provider->RenderTo( provider, image32, NULL ) );
+     provider->Release( provider );
+
+     /* create a surface and render an image to it */
+#ifdef USE_IMAGE_HEADERS
+     ddsc.flags         = DBDESC_MEMORY;
+     ddsc.memory.data   = GET_IMAGEDATA( sacred_heart );
+     ddsc.memory.length = GET_IMAGESIZE( sacred_heart );
+#else
+     ddsc.flags         = DBDESC_FILE;
+     ddsc.file          = GET_IMAGEFILE( sacred_heart );
+#endif
+     DFBCHECK(dfb->CreateDataBuffer( dfb, &ddsc, &buffer ));
+     DFBCHECK(buffer->CreateImageProvider( buffer, &provider ));
+     buffer->Release( buffer );
+     provider->GetSurfaceDescription( provider, &sdsc );
+     sdsc.width       = SX;
+     sdsc.height      = SY;
+     sdsc.pixelformat = DSPF_ARGB;
+     IMAGECHECK( dfb->CreateSurface( dfb, &sdsc, &image32a ) );
+     IMAGECHECK( provider->RenderTo( provider, image32a, NULL ) );
+     provider->Release( provider );
+
+     /* create a surface and render an image to it */
+#ifdef USE_IMAGE_HEADERS
+     ddsc.flags         = DBDESC_MEMORY;
+     ddsc.memory.data   = GET_IMAGEDATA( fish );
+     ddsc.memory.length = GET_IMAGESIZE( fish );
+#else
+     ddsc.flags         = DBDESC_FILE;
+     ddsc.file          = GET_IMAGEFILE( fish );
+#endif
+     DFBCHECK(dfb->CreateDataBuffer( dfb, &ddsc, &buffer ));
+     DFBCHECK(buffer->CreateImageProvider( buffer, &provider ));
+     buffer->Release( buffer );
+     provider->GetSurfaceDescription( provider, &sdsc );
+     sdsc.width       = SX;
+     sdsc.height      = SY;
+     sdsc.pixelformat = DSPF_A8;
+     IMAGECHECK( dfb->CreateSurface( dfb, &sdsc, &image8a ) );
+     IMAGECHECK( provider->RenderTo( provider, image8a, NULL ) );
+     provider->Release( provider );
+
+     trace_end( "create images", "setup", trace );
+
+     return DFB_OK;
+
+error:
+     provider->Release( provider );
+
+     trace_end( "create images", "setup", trace );
+
+     fprintf( stderr, "Could not create the test images in %s (%s)!\n",
+              dfb_pixelformat_name( pixelformat ), DirectFBErrorString( ret ) );
+
+     return ret;
+}
+
+/* run the benchmark loop without any operation for a fraction of a second */
+static double measure_overhead( void )
+{
+     long              i;
+     long long         t, ns;
+     volatile unsigned sink = 0;
+
+     bench_prepare();
+
+     /* the loop ends SAMPLETIME milliseconds after t */
+     t  = direct_clock_get_millis() - SAMPLETIME + 200;
+     ns = nanos();
+
+     for (i = 0; bench_running( i, t ); i++) {
+          const BenchParam *p = PARAM( i );
+
+          sink += p->x + p->y + p->r;
+     }
+
+     ns = nanos() - ns;
+
+     return (double) ns / i;
+}
+
+/* create a destination surface of SW x SH using the benchmark options, a primary subsurface if not offscreen */
+static IDirectFBSurface *create_dest( bool offscreen )
+{
+     IDirectFBSurface *surface;
+     long long         trace = trace_begin();
+
+     if (do_system || offscreen || pitch_pad) {
+          DFBSurfaceDescription sdsc;
+
+          sdsc.flags       = DSDESC_WIDTH | DSDESC_HEIGHT | DSDESC_PIXELFORMAT | DSDESC_CAPS;
+          sdsc.width       = SW;
+          sdsc.height      = SH;
+          sdsc.pixelformat = pixelformat;
+          sdsc.caps        = do_system ? DSCAPS_SYSTEMONLY : DSCAPS_NONE;
+
+          /* system memory with the line length padded */
+          if (pitch_pad) {
+               sdsc.flags                 |= DSDESC_PREALLOCATED;
+               sdsc.preallocated[0].pitch  = DFB_BYTES_PER_LINE( pixelformat, SW ) + pitch_pad;
+               sdsc.preallocated[0].data   = D_CALLOC( DFB_PLANE_MULTIPLY( pixelformat, SH ),
+                                                       sdsc.preallocated[0].pitch );
+               if (!sdsc.preallocated[0].data) {
+                    fprintf( stderr, "Out of memory!\n" );
+                    exit( 1 );
+               }
+          }
+
+          DFBCHECK(dfb->CreateSurface( dfb, &sdsc, &surface ));
+
+          if (pitch_pad) {
+               PaddedBuffer *buffers;
+
+               buffers = D_REALLOC( padded_buffers, (num_padded_buffers + 1) * sizeof(PaddedBuffer) );
+               if (!buffers) {
+                    fprintf( stderr, "Out of memory!\n" );
+                    exit( 1 );
+               }
+
+               padded_buffers = buffers;
+
+               padded_buffers[num_padded_buffers].surface = surface;
+               padded_buffers[num_padded_buffers].data    = sdsc.preallocated[0].data;
+               num_padded_buffers++;
+          }
+
+          surface->Clear( surface, 0, 0, 0, 0x80 );
+     }
+     else {
+          DFBRectangle rect = { 0, 0, SW, SH };
+
+          DFBCHECK(primary->GetSubSurface( primary, &rect, &surface ));
+     }
+
+     if (do_noaccel)
+          surface->DisableAcceleration( surface, DFXL_ALL );
+
+     surface->SetFont( surface, bench_font );
+
+     if (do_matrix) {
+          const s32 matrix[9] = { 0x01000, 0x19F00, 0x00000,
+                                  0x08A00, 0x01000, 0x00000,
+                                  0x00000, 0x00000, 0x10000 };
+
+          surface->SetMatrix( surface, matrix );
+     }
+
+     surface->SetRenderOptions( surface, dest_render_options() );
+
+     trace_end( "create destination", "setup", trace );
+
+     return surface;
+}
+
+/* release a destination created by create_dest() including its padded buffer */
+static void release_dest( IDirectFBSurface *surface )
+{
+     int i;
+
+     surface->Release( surface );
+
+     if (!pitch_pad)
+          return;
+
+     for (i = 0; i < num_padded_buffers; i++) {
+          if (padded_buffers[i].surface == surface) {
+               D_FREE( padded_buffers[i].data );
+
+               padded_buffers[i] = padded_buffers[--num_padded_buffers];
+               break;
+          }
+     }
+}
+
+static bool run_iteration( Demo *demo, DemoSample *ret_sample )
+{
+     long long          t, dt, t1, t2;
+     long long          submit, drain, drain_cpu;
+     long long          trace = trace_begin();
+     unsigned long long pixels;
+
+     showMessage( demo->message );
+
+     showStatus( demo->status );
+
+     trace_end( "showMessage", "ui", trace );
+
+     trace = trace_begin();
+
+     bench_prepare();
+
+     /* Get ready... */
+     direct_sync();
+     dfb->WaitIdle( dfb );
+
+     trace_end( "prepare", "setup", trace );
+
+     /* Take start... */
+     t1 = process_time();
+     t = direct_clock_get_millis();
+
+     if (do_perf)
+          perf_enable( true );
+
+     bench_excluded = 0;
+
+     submit = nanos();
+
+     /* Go... */
+     pixels = demo->func( t );
+
+     drain     = nanos();
+     drain_cpu = cpu_nanos();
+     submit    = drain - submit - bench_excluded * 1000000;
+
+     /* Wait... */
+     dfb->WaitIdle( dfb );
+
+     drain_cpu = cpu_nanos() - drain_cpu;
+     drain     = nanos() - drain;
+
+     if (trace_filename) {
+          long long now = direct_clock_get_micros();
+
+          trace_add( demo->desc, "benchmark", now - (submit + drain) / 1000, now - drain / 1000, -1 );
+          trace_add( "sync", "benchmark", now - drain / 1000, now, -1 );
+     }
+
+     if (do_perf) {
+          perf_enable( false );
+          perf_ops += pixels;
+     }
+
+     /* Take stop... */
+     dt = direct_clock_get_millis() - t - bench_excluded;
+     t2 = process_time();
+
+     if (!pixels || !dt)
+          return false;
+
+     primary->Flip( primary, NULL, DSFLIP_NONE );
+
+     ret_sample->ops     = pixels;
+     ret_sample->elapsed = dt;
+     ret_sample->load    = (t2 - t1) * 1000 / (ticks_per_second() * dt / 1000);
+     ret_sample->submit  = submit;
+     ret_sample->drain   = drain;
+
+     ret_sample->drain_idle = drain > 0 ? CLAMP( 1000 - drain_cpu * 1000 / drain, 0, 1000 ) : 1000;
+
+     return true;
+}
+
+/**********************************************************************************************************************/
+
+typedef struct {
+     DirectThread       *thread;
+     int                 index;
+     IDirectFBSurface   *dest;
+     unsigned long long  pixels;
+     long long           end;        /* without the excluded setup time */
+     long long           excluded;
+     bool                accelerated;
+} BenchWorker;
+
+static DirectMutex     workers_lock;
+static DirectWaitQueue workers_cond;
+static int             workers_ready;
+static bool            workers_go;
+static long long       workers_start;
+
+static void *bench_worker_main( DirectThread *thread, void *arg )
+{
+     BenchWorker *worker = arg;
+
+     dest         = worker->dest;
+     bench_worker = true;
+     rand_pool   ^= worker->index * 0x9E3779B9;
+
+     /* wait until all workers are ready */
+     direct_mutex_lock( &workers_lock );
+
+     workers_ready++;
+     direct_waitqueue_broadcast( &workers_cond );
+
+     while (!workers_go)
+          direct_waitqueue_wait( &workers_cond, &workers_lock );
+
+     direct_mutex_unlock( &workers_lock );
+
+     bench_excluded = 0;
+
+     worker->pixels      = current_demo->func( workers_start );
+     worker->excluded    = bench_excluded;
+     worker->end         = direct_clock_get_millis() - bench_excluded;
+     worker->accelerated = bench_accelerated;
+
+     return NULL;
+}
+
+/* run the demo in 1 to num_threads concurrent threads, each with its own destination surface */
+static bool run_threads( Demo *demo )
+{
+     int          i, n;
+     long         single = 0;
+     BenchWorker *workers;
+
+     /* all threads would replay into the same surfaces and change their state concurrently */
+     if (demo->func == replay_trace) {
+          fprintf( stderr, "%s: skipped, not supported with --threads!\n", demo->desc );
+          return false;
+     }
+
+     workers = D_CALLOC( num_threads, sizeof(BenchWorker) );
+     if (!workers)
+          return false;
+
+     showMessage( demo->message );
+
+     showStatus( demo->status );
+
+     bench_prepare();
+
+     direct_mutex_init( &workers_lock );
+     direct_waitqueue_init( &workers_cond );
+
+     for (n = 1; n <= num_threads; n++) {
+          long               perf;
+          long long          dt;
+          long long          excluded = 0;
+          unsigned long long pixels = 0;
+
+          workers_ready = 0;
+          workers_go    = false;
+
+          load_phases_reset();
+
+          frame_times_reset();
+
+          if (do_perf)
+               perf_reset();
+
+          for (i = 0; i < n; i++) {
+               char name[16];
+
+               snprintf( name, sizeof(name), "Benchmark %d", i );
+
+               workers[i].index  = i;
+               /* separate surfaces, threads writing to the same memory would contend for cache lines */
+               workers[i].dest   = create_dest( true );
+               workers[i].thread = direct_thread_create( DTT_DEFAULT, bench_worker_main, &workers[i], name );
+          }
+
+          /* Get ready... */
+          direct_sync();
+          dfb->WaitIdle( dfb );
+
+          direct_mutex_lock( &workers_lock );
+
+          while (workers_ready < n)
+               direct_waitqueue_wait( &workers_cond, &workers_lock );
+
+          if (do_perf)
+               perf_enable( true );
+
+          /* Go... */
+          workers_start = direct_clock_get_millis();
+          workers_go    = true;
+          direct_waitqueue_broadcast( &workers_cond );
+
+          direct_mutex_unlock( &workers_lock );
+
+          for (i = 0; i < n; i++) {
+               direct_thread_join( workers[i].thread );
+               direct_thread_destroy( workers[i].thread );
+          }
+
+          /* Wait... */
+          dfb->WaitIdle( dfb );
+
+          dt = direct_clock_get_millis() - workers_start;
+
+          if (do_perf)
+               perf_enable( false );
+
+          for (i = 0; i < n; i++) {
+               pixels   += workers[i].pixels;
+               excluded  = MAX( excluded, workers[i].excluded );
+
+               if (workers[i].accelerated)
+                    demo->accelerated = DFB_TRUE;
+
+               release_dest( workers[i].dest );
+          }
+
+          perf_ops = pixels;
+
+          /* the workers ran concurrently, the longest excluded setup delayed the end */
+          dt -= excluded;
+
+          if (!pixels || dt <= 0)
+               break;
+
+          primary->Flip( primary, NULL, DSFLIP_NONE );
+
+          perf = pixels / dt;
+          if (n == 1)
+               single = perf;
+
+          demo->result   = perf;
+          demo->duration = dt;
+
+          if (output_csv)
+               printf( "%s,%d,%ld.%.3ld,%s", demo->desc, n, perf / 1000, perf % 1000, demo->unit );
+          else
+               printf( "%-44s %2d thread%s (%s%4ld.%.3ld %s) x%.2f [",
+                       demo->desc, n, n > 1 ? "s" : " ", demo->accelerated ? "*" : " ",
+                       perf / 1000, perf % 1000, demo->unit, single ? (double) perf / single : 0 );
+
+          for (i = 0; i < n; i++) {
+               long long wdt = workers[i].end - workers_start;
+
+               perf = wdt ? workers[i].pixels / wdt : 0;
+
+               printf( "%s%ld.%.3ld", output_csv ? "," : i ? " " : "", perf / 1000, perf % 1000 );
+          }
+
+          printf( output_csv ? "" : "]" );
+
+          load_phases_print();
+
+          frame_times_print();
+
+          perf_print( demo );
+
+          printf( "\n" );
+     }
+
+     direct_waitqueue_deinit( &workers_cond );
+     direct_mutex_deinit( &workers_lock );
+
+     D_FREE( workers );
+
+     return demo->result != 0;
+}
+
+/**********************************************************************************************************************/
+
+static u32 crc32_update( u32 crc, const u8 *data, int length )
+{
+     static u32 table[256];
+
+     if (!table[1]) {
+          int i, j;
+
+          for (i = 0; i < 256; i++) {
+               u32 c = i;
+
+               for (j = 0; j < 8; j++)
+                    c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+
+               table[i] = c;
+          }
+     }
+
+     crc = ~crc;
+
+     while (length--)
+          crc = table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+
+     return ~crc;
+}
+
+static VerifyReference *add_reference( const char *key, u64 hash, int num_rows )
+{
+     VerifyReference *ref;
+
+     references = D_REALLOC( references, (num_references + 1) * sizeof(VerifyReference) );
+     if (!references) {
+          fprintf( stderr, "Out of memory!\n" );
+          exit( 1 );
+     }
+
+     ref = &references[num_references++];
+
+     snprintf( ref->key, sizeof(ref->key), "%s", key );
+     ref->hash     = hash;
+     ref->num_rows = num_rows;
+     ref->rows     = D_CALLOC( num_rows ?: 1, sizeof(u32) );
+
+     return ref;
+}
+
+static void load_references( const char *name )
+{
+     int                 i, num_rows;
+     char                key[256];
+     unsigned long long  hash;
+     FILE               *f;
+
+     f = fopen( name, "r" );
+     if (!f)
+          return;
+
+     while (fscanf( f, "%255s %llx %d", key, &hash, &num_rows ) == 3 && num_rows > 0) {
+          VerifyReference *ref = add_reference( key, hash, num_rows );
+
+          for (i = 0; i < num_rows; i++) {
+               if (fscanf( f, "%x", &ref->rows[i] ) != 1)
+                    break;
+          }
+     }
+
+     fclose( f );
+}
+
+static void save_references( const char *name )
+{
+     int   i, j;
+     FILE *f;
+
+     f = fopen( name, "w" );
+     if (!f) {
+          fprintf( stderr, "Could not open '%s' for writing!\n", name );
+          return;
+     }
+
+     for (i = 0; i < num_references; i++) {
+          fprintf( f, "%s %016llx %d", references[i].key, (unsigned long long) references[i].hash, references[i].num_rows );
+
+          for (j = 0; j < references[i].num_rows; j++)
+               fprintf( f, " %08x", references[i].rows[j] );
+
+          fprintf( f, "\n" );
+     }
+
+     fclose( f );
+}
+
+/*
+ * Render a fixed number of operations with a fixed random seed into an offscreen surface
+ * and compare per-row CRCs and a global hash against the reference file.
+ */
+static void verify_demo( Demo *demo )
+{
+     int               i, y, pitch, num_rows;
+     void             *data;
+     char              key[256];
+     u64               hash = 0xCBF29CE484222325ULL;
+     u32              *rows;
+     VerifyReference  *ref  = NULL;
+     IDirectFBSurface *saved = dest;
+
+     /* load-image doesn't render to the destination */
+     if (demo->func == load_image)
+          return;
+
+     /* include the chroma planes of planar formats */
+     num_rows = DFB_PLANE_MULTIPLY( pixelformat, SH );
+
+     rows = D_MALLOC( num_rows * sizeof(u32) );
+     if (!rows)
+          return;
+
+     rand_pool = 0x12345678;
+     rand_add  = 0x87654321;
+
+     bench_prepare();
+
+     dest = create_dest( true );
+
+     bench_limit = verify_ops;
+
+     demo->func( direct_clock_get_millis() );
+
+     bench_limit = 0;
+
+     dfb->WaitIdle( dfb );
+
+     DFBCHECK(dest->Lock( dest, DSLF_READ, &data, &pitch ));
+
+     for (y = 0; y < num_rows; y++) {
+          rows[y] = crc32_update( 0, (u8*) data + y * pitch, DFB_BYTES_PER_LINE( pixelformat, SW ) );
+
+          /* FNV-1a over the row CRCs */
+          for (i = 0; i < 4; i++) {
+               hash ^= (rows[y] >> (i * 8)) & 0xFF;
+               hash *= 0x100000001B3ULL;
+          }
+     }
+
+     dest->Unlock( dest );
+
+     release_dest( dest );
+
+     dest = saved;
+
+     snprintf( key, sizeof(key), "%s/%s/%dx%d/%dx%d/%d%s%s%s%s%s", demo->option, dfb_pixelformat_name( pixelformat ),
+               SX, SY, SW, SH, batch_size, do_aa ? "/aa" : "", do_matrix ? "/matrix" : "", do_xor ? "/xor" : "",
+               do_smooth ? "/smooth" : "", do_noaccel ? "/noaccel" : "" );
+
+     for (i = 0; i < num_references; i++) {
+          if (!strcmp( references[i].key, key )) {
+               ref = &references[i];
+               break;
+          }
+     }
+
+     if (!ref) {
+          ref = add_reference( key, hash, num_rows );
+
+          memcpy( ref->rows, rows, num_rows * sizeof(u32) );
+
+          references_changed = true;
+
+          demo->verify = VERIFY_RECORDED;
+     }
+     else if (ref->hash != hash || ref->num_rows != num_rows) {
+          for (y = 0; y < MIN( num_rows, ref->num_rows ); y++) {
+               if (ref->rows[y] != rows[y])
+                    break;
+          }
+
+          fprintf( stderr, "%s: verification failed, first mismatch in row %d\n", demo->desc, y );
+
+          demo->verify = VERIFY_FAILED;
+     }
+     else
+          demo->verify = VERIFY_OK;
+
+     D_FREE( rows );
+}
+
+/**********************************************************************************************************************/
+
+/*
+ * Dumps in PNG or raw format are copied from the surface before the next benchmark starts,
+ * encoding and writing is done by a background thread.
+ */
+typedef enum {
+     DUMP_PPM,                        /* synchronous IDirectFBSurface::Dump() */
+     DUMP_PNG,                        /* ARGB converted to RGBA PNG */
+     DUMP_RAW                         /* pixel data in the surface format with a text header, deflated with zlib */
+} DumpFormat;
+
+static const char *dump_format_names[] = { "ppm", "png", "raw" };
+
+typedef struct __DumpJob DumpJob;
+
+struct __DumpJob {
+     DumpJob               *next;
+     char                   name[256];
+     DFBSurfacePixelFormat  format;
+     int                    width;
+     int                    height;
+     int                    pitch;
+     int                    rows;
+     u8                    *data;
+};
+
+static DirectThread     *dump_thread = NULL;
+static DirectMutex       dump_lock;
+static DirectWaitQueue   dump_cond;
+static DumpJob          *dump_jobs   = NULL;
+static bool              dump_quit   = false;
+static IDirectFBSurface *dump_copy   = NULL;
+static int               dump_index  = 0;
+
+static void write_be32( u8 *buf, u32 value )
+{
+     buf[0] = value >> 24;
+     buf[1] = value >> 16;
+     buf[2] = value >> 8;
+     buf[3] = value;
+}
+
+static void write_png_chunk( FILE *f, const char *type, const u8 *data, u32 length )
+{
+     u8  buf[4];
+     u32 crc;
+
+     write_be32( buf, length );
+     fwrite( buf, 4, 1, f );
+
+     crc = crc32_update( 0, (const u8*) type, 4 );
+     crc = crc32_update( crc, data, length );
+
+     fwrite( type, 4, 1, f );
+     fwrite( data, length, 1, f );
+
+     write_be32( buf, crc );
+     fwrite( buf, 4, 1, f );
+}
+
+/* wrap data into a zlib stream, using stored blocks if zlib is not available */
+static u8 *deflate_data( const u8 *data, unsigned long length, unsigned long *ret_length )
+{
+     u8            *out;
+#ifdef HAVE_ZLIB
+     unsigned long  size = compressBound( length );
+
+     out = D_MALLOC( size );
+     if (!out)
+          return NULL;
+
+     if (compress2( out, &size, data, length, Z_BEST_SPEED ) != Z_OK) {
+          D_FREE( out );
+          return NULL;
+     }
+
+     *ret_length = size;
+#else
+     unsigned long  i, n;
+     u32            a = 1, b = 0;
+     u8            *p;
+
+     out = D_MALLOC( length + (length / 65535 + 1) * 5 + 6 );
+     if (!out)
+          return NULL;
+
+     p = out;
+
+     *p++ = 0x78;
+     *p++ = 0x01;
+
+     for (i = 0; i == 0 || i < length; i += n) {
+          n = MIN( length - i, 65535 );
+
+          *p++ = i + n == length;
+          *p++ = n;
+          *p++ = n >> 8;
+          *p++ = ~n;
+          *p++ = ~n >> 8;
+
+          memcpy( p, data + i, n );
+          p += n;
+     }
+
+     for (i = 0; i < length; i++) {
+          a = (a + data[i]) % 65521;
+          b = (b + a) % 65521;
+     }
+
+     write_be32( p, (b << 16) | a );
+     p += 4;
+
+     *ret_length = p - out;
+#endif
+
+     return out;
+}
+
+static void dump_write_png( const DumpJob *job, FILE *f )
+{
+     static const u8  signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+     int              x, y;
+     u8               header[13];
+     u8              *raw, *png;
+     unsigned long    length;
+
+     raw = D_MALLOC( (1 + job->width * 4) * job->height );
+     if (!raw)
+          return;
+
+     /* one row filter byte (none) followed by RGBA pixels */
+     for (y = 0; y < job->height; y++) {
+          const u32 *src = (const u32*) (job->data + y * job->pitch);
+          u8        *dst = raw + y * (1 + job->width * 4);
+
+          *dst++ = 0;
+
+          for (x = 0; x < job->width; x++) {
+               *dst++ = src[x] >> 16;
+               *dst++ = src[x] >> 8;
+               *dst++ = src[x];
+               *dst++ = src[x] >> 24;
+          }
+     }
+
+     png = deflate_data( raw, (1 + job->width * 4) * job->height, &length );
+
+     D_FREE( raw );
+
+     if (!png)
+          return;
+
+     write_be32( header, job->width );
+     write_be32( header + 4, job->height );
+     header[8]  = 8; /* bit depth */
+     header[9]  = 6; /* RGBA */
+     header[10] = 0;
+     header[11] = 0;
+     header[12] = 0;
+
+     fwrite( signature, sizeof(signature), 1, f );
+
+     write_png_chunk( f, "IHDR", header, sizeof(header) );
+     write_png_chunk( f, "IDAT", png, length );
+     write_png_chunk( f, "IEND", NULL, 0 );
+
+     D_FREE( png );
+}
+
+static void dump_write_raw( const DumpJob *job, FILE *f )
+{
+     u8            *raw;
+     unsigned long  length;
+
+     raw = deflate_data( job->data, job->pitch * job->rows, &length );
+     if (!raw)
+          return;
+
+     fprintf( f, "DFBRAW %s %d %d %d %d\n",
+              dfb_pixelformat_name( job->format ), job->width, job->height, job->pitch, job->rows );
+
+     fwrite( raw, length, 1, f );
+
+     D_FREE( raw );
+}
+
+static void *dump_thread_main( DirectThread *thread, void *arg )
+{
+     while (true) {
+          DumpJob *job;
+          FILE    *f;
+
+          direct_mutex_lock( &dump_lock );
+
+          while (!dump_jobs && !dump_quit)
+               direct_waitqueue_wait( &dump_cond, &dump_lock );
+
+          job = dump_jobs;
+          if (job)
+               dump_jobs = job->next;
+
+          direct_mutex_unlock( &dump_lock );
+
+          if (!job)
+               break;
+
+          f = fopen( job->name, "wb" );
+          if (f) {
+               if (job->format == DSPF_ARGB && dump_format == DUMP_PNG)
+                    dump_write_png( job, f );
+               else
+                    dump_write_raw( job, f );
+
+               fclose( f );
+          }
+          else
+               fprintf( stderr, "Could not open '%s' for writing!\n", job->name );
+
+          D_FREE( job->data );
+          D_FREE( job );
+     }
+
+     return NULL;
+}
+
+/* copy the surface and queue it for writing in the background */
+static void dump_async( IDirectFBSurface *surface, const char *name )
+{
+     int                    y, w, h, pitch;
+     void                  *data;
+     DumpJob               *job, **last;
+     DFBSurfacePixelFormat  format;
+     IDirectFBSurface      *source = surface;
+     long long              trace  = trace_begin();
+
+     surface->GetSize( surface, &w, &h );
+     surface->GetPixelFormat( surface, &format );
+
+     /* convert to ARGB for PNG */
+     if (dump_format == DUMP_PNG) {
+          if (dump_copy) {
+               int cw, ch;
+
+               dump_copy->GetSize( dump_copy, &cw, &ch );
+
+               if (cw != w || ch != h) {
+                    dump_copy->Release( dump_copy );
+                    dump_copy = NULL;
+               }
+          }
+
+          if (!dump_copy) {
+               DFBSurfaceDescription sdsc;
+
+               sdsc.flags       = DSDESC_WIDTH | DSDESC_HEIGHT | DSDESC_PIXELFORMAT | DSDESC_CAPS;
+               sdsc.width       = w;
+               sdsc.height      = h;
+               sdsc.pixelformat = DSPF_ARGB;
+               sdsc.caps        = DSCAPS_SYSTEMONLY;
+
+               DFBCHECK(dfb->CreateSurface( dfb, &sdsc, &dump_copy ));
+          }
+
+          dump_copy->SetBlittingFlags( dump_copy, DSBLIT_NOFX );
+          dump_copy->Blit( dump_copy, surface, NULL, 0, 0 );
+
+          source = dump_copy;
+          format = DSPF_ARGB;
+     }
+
+     job = D_CALLOC( 1, sizeof(DumpJob) );
+     if (!job)
+          return;
+
+     snprintf( job->name, sizeof(job->name), "%s_%04d.%s", name, dump_index++, dump_format_names[dump_format] );
+
+     job->format = format;
+     job->width  = w;
+     job->height = h;
+     job->pitch  = DFB_BYTES_PER_LINE( format, w );
+     job->rows   = DFB_PLANE_MULTIPLY( format, h );
+     job->data   = D_MALLOC( job->pitch * job->rows );
+
+     if (!job->data || source->Lock( source, DSLF_READ, &data, &pitch )) {
+          if (job->data)
+               D_FREE( job->data );
+
+          D_FREE( job );
+          return;
+     }
+
+     for (y = 0; y < job->rows; y++)
+          memcpy( job->data + y * job->pitch, (u8*) data + y * pitch, job->pitch );
+
+     source->Unlock( source );
+
+     trace_end( "dump copy", "output", trace );
+
+     if (!dump_thread) {
+          direct_mutex_init( &dump_lock );
+          direct_waitqueue_init( &dump_cond );
+
+          dump_thread = direct_thread_create( DTT_DEFAULT, dump_thread_main, NULL, "Dump Writer" );
+     }
+
+     direct_mutex_lock( &dump_lock );
+
+     for (last = &dump_jobs; *last; last = &(*last)->next);
+
+     *last = job;
+
+     direct_waitqueue_signal( &dump_cond );
+
+     direct_mutex_unlock( &dump_lock );
+}
+
+/* wait until all queued dumps are written */
+static void dump_finish( void )
+{
+     if (!dump_thread)
+          return;
+
+     direct_mutex_lock( &dump_lock );
+
+     dump_quit = true;
+
+     direct_waitqueue_signal( &dump_cond );
+
+     direct_mutex_unlock( &dump_lock );
+
+     direct_thread_join( dump_thread );
+     direct_thread_destroy( dump_thread );
+
+     direct_waitqueue_deinit( &dump_cond );
+     direct_mutex_deinit( &dump_lock );
+
+     dump_thread = NULL;
+     dump_quit   = false;
+
+     if (dump_copy) {
+          dump_copy->Release( dump_copy );
+          dump_copy = NULL;
+     }
+}
+
+/**********************************************************************************************************************/
+
+/* append the average submit and drain times of all samples to the result line */
+static void drain_print( const Demo *demo )
+{
+     int       i;
+     long long submit = 0;
+     long long drain  = 0;
+     long      idle   = 0;
+
+     if (!demo->num_samples)
+          return;
+
+     for (i = 0; i < demo->num_samples; i++) {
+          submit += demo->samples[i].submit;
+          drain  += demo->samples[i].drain;
+          idle   += demo->samples[i].drain_idle;
+     }
+
+     submit /= demo->num_samples;
+     drain  /= demo->num_samples;
+     idle   /= demo->num_samples;
+
+     printf( output_csv ? ",%.3f,%.3f,%ld.%ld" : "\n     submit %.3f ms  drain %.3f ms  CPU idle during drain %ld.%ld%%",
+             submit / 1000000.0, drain / 1000000.0, idle / 10, idle % 10 );
+}
+
+static void measure_demo( Demo *demo )
+{
+     int        j, skip;
+     long long  start, trace;
+     DemoSample sample;
+     DemoStats  stats;
+
+     current_demo = demo;
+
+     skip = 0;
+
+     if (verify_filename)
+          verify_demo( demo );
+
+     if (num_threads) {
+          run_threads( demo );
+          return;
+     }
+
+     if (latency_batch) {
+          if (!demo->latency)
+               demo->latency = D_MALLOC( sizeof(LatencyHistogram) );
+
+          if (demo->latency)
+               memset( demo->latency, 0, sizeof(LatencyHistogram) );
+     }
+
+     latency_hist = NULL;
+
+     for (j = 0; j < WARMUP; j++) {
+          if (!run_iteration( demo, &sample )) {
+               skip = 1;
+               break;
+          }
+     }
+
+     latency_hist = demo->latency;
+
+     load_phases_reset();
+
+     frame_times_reset();
+
+     if (do_perf)
+          perf_reset();
+
+     start = direct_clock_get_millis();
+
+     for (j = 0; !skip; j++) {
+          long perf;
+
+          if (!run_iteration( demo, &sample )) {
+               skip = 1;
+               break;
+          }
+
+          add_sample( demo, &sample );
+
+          perf = sample.ops / sample.elapsed;
+          if (perf > demo->result) {
+               demo->result   = perf;
+               demo->load     = sample.load;
+               demo->duration = sample.elapsed;
+          }
+
+          if (j + 1 < ITERATIONS)
+               continue;
+
+          if (!converge || converged( demo ) || direct_clock_get_millis() - start >= MAXTIME)
+               break;
+     }
+
+     latency_hist = NULL;
+
+     if (skip)
+          return;
+
+     trace = trace_begin();
+
+     calc_stats( demo, &stats );
+
+     /* in convergence mode the mean is reported instead of the best iteration */
+     if (converge) {
+          demo->result   = stats.mean * 1000;
+          demo->duration = direct_clock_get_millis() - start;
+     }
+
+     if (output_csv) {
+          printf( "%s%s%s,%ld.%.3ld,%s,%ld.%.3ld,%s,%d.%d",
+                  do_aa ? "AA " : "",
+                  do_matrix ? "MX " : "",
+                  demo->desc, demo->duration / 1000, demo->duration % 1000,
+                  demo->accelerated ? "*" : " ",
+                  demo->result / 1000, demo->result % 1000, demo->unit,
+                  demo->load / 10, demo->load % 10 );
+     }
+     else {
+          printf( "%s%s%-44s %3ld.%.3ld secs (%s%4ld.%.3ld %s) [%3d.%d%%]",
+                  do_aa ? "AA " : "",
+                  do_matrix ? "MX " : "",
+                  demo->desc, demo->duration / 1000, demo->duration % 1000,
+                  demo->accelerated ? "*" : " ",
+                  demo->result / 1000, demo->result % 1000, demo->unit,
+                  demo->load / 10, demo->load % 10 );
+     }
 
-     dest->SetPorterDuff( dest, DSPD_SRC_OVER );
+     if (converge)
+          printf( output_csv ? ",%.3f,%.3f,%d" : " 95%%: %.3f..%.3f (%d)",
+                  stats.mean - stats.ci95, stats.mean + stats.ci95, demo->num_samples );
 
-     if (!showAccelerated( DFXL_BLIT, rose ))
-          return 0;
+     if (demo->latency && demo->latency->count) {
+          const LatencyHistogram *hist = demo->latency;
 
-     for (i = 0; i % 100 || direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          dest->Blit( dest, rose, NULL, SW != SX ? myrand() % (SW - SX) : 0, SH != SY ? myrand() % (SH - SY) : 0 );
+          printf( output_csv ? ",%.3f,%.3f,%.3f,%.3f,%.3f" :
+                  "\n     latency/call (usecs) p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f",
+                  latency_percentile( hist, 50 ) / 1000, latency_percentile( hist, 90 ) / 1000,
+                  latency_percentile( hist, 99 ) / 1000, latency_percentile( hist, 99.9 ) / 1000,
+                  hist->max / 1000.0 );
      }
 
-     dest->SetPorterDuff( dest, DSPD_NONE );
+     if (demo->verify)
+          printf( output_csv ? ",%s" : " [verify %s]", verify_names[demo->verify] );
 
-     return SX * SY * (unsigned long long) i;
+     calls_print( demo );
+
+     if (show_drain)
+          drain_print( demo );
+
+     load_phases_print();
+
+     frame_times_print();
+
+     perf_print( demo );
+
+     printf( "\n" );
+
+     if (do_system) {
+          primary->SetBlittingFlags( primary, DSBLIT_NOFX );
+          primary->Blit( primary, dest, NULL, 0, 0 );
+          sleep( 2 );
+          dest->Clear( dest, 0, 0, 0, 0x80 );
+     }
+
+     if (do_dump) {
+          int  index = 0;
+          char buf[200];
+
+          snprintf( buf, sizeof(buf), "DirectFB_%s%s%.127s",
+                    do_aa ? "AA " : "", do_matrix ? "MX " : "", demo->desc );
+
+          while (buf[index]) {
+               if (buf[index] == ' ')
+                    buf[index] = '_';
+
+               index++;
+          }
+
+          if (dump_format == DUMP_PPM)
+               primary->Dump( primary, ".", buf );
+          else
+               dump_async( primary, buf );
+     }
+
+     trace_end( "results", "output", trace );
+
+     if (do_wait)
+          sleep( do_wait );
 }
 
-static unsigned long long stretch_blit( long long t )
+static void run_demo( Demo *demo )
 {
-     long               i, l;
-     unsigned long long pixels = 0;
+     if (!demo_setup( demo ))
+          return;
 
-     SET_BLITTING_FLAGS( DSBLIT_NOFX );
+     measure_demo( demo );
 
-     if (!showAccelerated( DFXL_STRETCHBLIT, simple ))
-          return 0;
+     demo_teardown( demo );
+}
+
+/**********************************************************************************************************************/
+
+/* print results with one row per benchmark and one column per configuration, 0 means not run */
+static void print_matrix( const char *title, const char *const *columns, int num_columns, const long *results )
+{
+     int i, c;
+
+     if (output_csv) {
+          printf( "%s", title );
+          for (c = 0; c < num_columns; c++)
+               printf( ",%s", columns[c] );
+          printf( ",unit\n" );
+     }
+     else {
+          printf( "\n%-44s", title );
+          for (c = 0; c < num_columns; c++)
+               printf( " %11.11s", columns[c] );
+          printf( "\n" );
+     }
+
+     for (i = 0; i < num_demos; i++) {
+          if (!demos[i].requested)
+               continue;
+
+          printf( output_csv ? "%s" : "%-44.44s", demos[i].desc );
+
+          for (c = 0; c < num_columns; c++) {
+               long result = results[i * num_columns + c];
+
+               if (result)
+                    printf( output_csv ? ",%ld.%.3ld" : " %7ld.%.3ld", result / 1000, result % 1000 );
+               else
+                    printf( output_csv ? "," : " %11s", "-" );
+          }
+
+          printf( output_csv ? ",%s\n" : " %s\n", demos[i].unit );
+     }
+}
+
+/* run all requested demos and store the results in one column of the matrix */
+static void run_column( long *results, int column, int num_columns, const char *label )
+{
+     int i;
+
+     for (i = 0; i < num_demos; i++) {
+          if (!demos[i].requested)
+               continue;
+
+          demos[i].result      = 0;
+          demos[i].num_samples = 0;
+
+          run_demo( &demos[i] );
+
+          results[i * num_columns + column] = demos[i].result;
+     }
+
+     json_add_column( label );
+}
+
+static bool format_supported( DFBSurfacePixelFormat format )
+{
+     DFBSurfaceDescription  sdsc;
+     IDirectFBSurface      *surface;
+
+     sdsc.flags       = DSDESC_WIDTH | DSDESC_HEIGHT | DSDESC_PIXELFORMAT | DSDESC_CAPS;
+     sdsc.width       = SW;
+     sdsc.height      = SH;
+     sdsc.pixelformat = format;
+     sdsc.caps        = do_system ? DSCAPS_SYSTEMONLY : DSCAPS_NONE;
+
+     if (dfb->CreateSurface( dfb, &sdsc, &surface ))
+          return false;
 
-     for (i = 1; direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          if (i > SH) {
-               i = 10;
+     surface->Release( surface );
+
+     return true;
+}
+
+/* run all requested demos for each pixelformat, with destination and test images recreated in that format */
+static void run_format_sweep( void )
+{
+     int                    i, num = 0;
+     DFBSurfacePixelFormat  formats[D_ARRAY_SIZE(format_names)];
+     const char            *columns[D_ARRAY_SIZE(format_names)];
+     long                  *results;
+     DFBSurfacePixelFormat  saved_format = pixelformat;
+     IDirectFBSurface      *saved_dest   = dest;
+
+     if (sweep_formats) {
+          char *list = D_STRDUP( sweep_formats );
+          char *name = strtok( list, "," );
+
+          while (name && num < D_ARRAY_SIZE(formats)) {
+               DFBSurfacePixelFormat format = parse_pixelformat( name );
+
+               if (format != DSPF_UNKNOWN)
+                    formats[num++] = format;
+               else
+                    fprintf( stderr, "Unknown pixelformat '%s'!\n", name );
+
+               name = strtok( NULL, "," );
+          }
+
+          D_FREE( list );
+     }
+     else {
+          for (i = 0; i < D_ARRAY_SIZE(format_names); i++) {
+               if (format_names[i].format != DSPF_UNKNOWN)
+                    formats[num++] = format_names[i].format;
           }
+     }
+
+     results = D_CALLOC( num_demos * num, sizeof(long) );
+     if (!results)
+          return;
+
+     for (i = 0; i < num; i++) {
+          columns[i] = dfb_pixelformat_name( formats[i] );
 
-          for (l = 10; l < SH; l += i) {
-               DFBRectangle rect = { SW / 2 - l / 2, SH / 2 - l / 2, l, l };
+          if (!format_supported( formats[i] ))
+               continue;
+
+          pixelformat = formats[i];
 
-               dest->StretchBlit( dest, simple, NULL, &rect );
+          if (!output_csv)
+               printf( "\nBenchmarking %dx%d on %dx%d %s (%dbit)...\n",
+                       SX, SY, SW, SH, columns[i], DFB_BITS_PER_PIXEL( pixelformat ) );
 
-               pixels += rect.w * rect.h;
+          release_images();
+
+          if (create_images()) {
+               release_images();
+               continue;
           }
+
+          dest = create_dest( true );
+
+          run_column( results, i, num, columns[i] );
+
+          release_dest( dest );
      }
 
-     return pixels;
+     pixelformat = saved_format;
+     dest        = saved_dest;
+
+     release_images();
+     DFBCHECK(create_images());
+
+     print_matrix( "Pixelformat", columns, num, results );
+
+     D_FREE( results );
 }
 
-static unsigned long long stretch_blit_colorkeyed( long long t )
+/* run all requested demos for a geometric series of sizes, ending with the full benchmark area */
+static void run_size_sweep( void )
 {
-     long               i, l;
-     unsigned long long pixels = 0;
+     int          i, size, num = 0;
+     int          max_w, max_h;
+     int          widths[32], heights[32];
+     char         labels[32][16];
+     const char  *columns[32];
+     long        *results;
+     int          saved_sx = SX;
+     int          saved_sy = SY;
+
+     max_w = SW - 10;
+     max_h = SH - 10;
+
+     if (sweep_max > 0) {
+          max_w = MIN( max_w, sweep_max );
+          max_h = MIN( max_h, sweep_max );
+     }
 
-     SET_BLITTING_FLAGS( DSBLIT_SRC_COLORKEY );
+     for (size = MAX( sweep_min, 1 ); size < MIN( max_w, max_h ) && num < 31; size *= 2) {
+          widths[num]  = size;
+          heights[num] = size;
+          num++;
+     }
 
-     if (!showAccelerated( DFXL_STRETCHBLIT, simple ))
-          return 0;
+     widths[num]  = max_w;
+     heights[num] = max_h;
+     num++;
+
+     results = D_CALLOC( num_demos * num, sizeof(long) );
+     if (!results)
+          return;
 
-     for (i = 1; direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          if (i > SH) {
-               i = 10;
+     for (i = 0; i < num; i++) {
+          SX = widths[i];
+          SY = heights[i];
+
+          snprintf( labels[i], sizeof(labels[i]), "%dx%d", SX, SY );
+          columns[i] = labels[i];
+
+          if (!output_csv)
+               printf( "\nBenchmarking %dx%d on %dx%d %s (%dbit)...\n",
+                       SX, SY, SW, SH, dfb_pixelformat_name( pixelformat ), DFB_BITS_PER_PIXEL( pixelformat ) );
+
+          release_images();
+          DFBCHECK(create_images());
+
+          run_column( results, i, num, columns[i] );
+     }
+
+     SX = saved_sx;
+     SY = saved_sy;
+
+     release_images();
+     DFBCHECK(create_images());
+
+     print_matrix( "Size", columns, num, results );
+
+     D_FREE( results );
+}
+
+/* run all requested demos for each byte offset from a 64 byte boundary of the destination or the source x position */
+static void run_align_sweep( void )
+{
+     int          i, num = 0;
+     int          bpp = MAX( DFB_BYTES_PER_PIXEL( pixelformat ), 1 );
+     char         labels[64][8];
+     const char  *columns[64];
+     long        *results;
+
+     for (i = 0; i < 64 / bpp; i++) {
+          snprintf( labels[i], sizeof(labels[i]), "+%d", i * bpp );
+          columns[i] = labels[i];
+     }
+
+     num = i;
+
+     results = D_CALLOC( num_demos * num, sizeof(long) );
+     if (!results)
+          return;
+
+     for (i = 0; i < num; i++) {
+          bench_align_dst = align_sweep == 1 ? i : 0;
+          bench_align_src = align_sweep == 1 ? 0 : i;
+
+          if (!output_csv)
+               printf( "\nBenchmarking %dx%d on %dx%d %s (%dbit) with %s x at %s bytes...\n",
+                       SX, SY, SW, SH, dfb_pixelformat_name( pixelformat ), DFB_BITS_PER_PIXEL( pixelformat ),
+                       align_sweep == 1 ? "destination" : "source", columns[i] );
+
+          run_column( results, i, num, columns[i] );
+     }
+
+     bench_align_dst = -1;
+     bench_align_src = -1;
+
+     print_matrix( align_sweep == 1 ? "Destination alignment" : "Source alignment", columns, num, results );
+
+     D_FREE( results );
+}
+
+/**********************************************************************************************************************/
+
+/* resource usage of the process, -1 if not available */
+typedef struct {
+     long                 rss;        /* resident memory in KiB */
+     long                 shared;     /* resident shared memory in KiB, including shared memory surface pools */
+     int                  fds;        /* open file descriptors */
+} SoakUsage;
+
+static void soak_usage( SoakUsage *usage )
+{
+     FILE          *f;
+     DIR           *dir;
+     struct dirent *entry;
+     long           size, rss, shared;
+     long           page = direct_pagesize() / 1024;
+
+     usage->rss    = -1;
+     usage->shared = -1;
+     usage->fds    = -1;
+
+     f = fopen( "/proc/self/statm", "r" );
+     if (f) {
+          if (fscanf( f, "%ld %ld %ld", &size, &rss, &shared ) == 3) {
+               usage->rss    = rss * page;
+               usage->shared = shared * page;
           }
 
-          for (l = 10; l < SH; l += i) {
-               DFBRectangle rect = { SW / 2 - l / 2, SH / 2 - l / 2, l, l };
+          fclose( f );
+     }
 
-               dest->StretchBlit( dest, colorkeyed, NULL, &rect );
+     dir = opendir( "/proc/self/fd" );
+     if (dir) {
+          usage->fds = 0;
 
-               pixels += rect.w * rect.h;
+          while ((entry = readdir( dir )) != NULL) {
+               if (entry->d_name[0] != '.')
+                    usage->fds++;
           }
+
+          /* not counting the descriptor of the directory itself */
+          usage->fds--;
+
+          closedir( dir );
      }
+}
 
-     return pixels;
+/* least squares slope of y over x */
+static double slope( const double *x, const double *y, int n, int stride )
+{
+     int    i;
+     double mx = 0, my = 0, sxy = 0, sxx = 0;
+
+     for (i = 0; i < n; i++) {
+          mx += x[i];
+          my += y[i * stride];
+     }
+
+     mx /= n;
+     my /= n;
+
+     for (i = 0; i < n; i++) {
+          sxy += (x[i] - mx) * (y[i * stride] - my);
+          sxx += (x[i] - mx) * (x[i] - mx);
+     }
+
+     return sxx > 0 ? sxy / sxx : 0;
 }
 
-static unsigned long long load_image( long long t )
+/* drift of y over the whole run relative to its mean, based on the fitted slope */
+static double soak_drift( const double *x, const double *y, int n, int stride )
 {
-     int                     i;
-     DFBSurfaceDescription   dsc;
-     char                    buf[32];
-     IDirectFBImageProvider *provider;
-     IDirectFBSurface       *surface = NULL;
+     int    i;
+     double mean = 0;
 
-     if (!filename || accel_only)
-          return 0;
+     for (i = 0; i < n; i++)
+          mean += y[i * stride];
 
-     for (i = 0; direct_clock_get_millis() < (t + DEMOTIME); i++) {
-          /* create an image provider for loading the file */
-          DFBCHECK(dfb->CreateImageProvider( dfb, filename, &provider ));
+     mean /= n;
 
-          /* retrieve a surface description for the image */
-          provider->GetSurfaceDescription( provider, &dsc );
+     return mean ? slope( x, y, n, stride ) * (x[n-1] - x[0]) / mean * 100 : 0;
+}
 
-          /* use the specified pixelformat */
-          if (pixelformat != DSPF_UNKNOWN)
-               dsc.pixelformat = pixelformat;
+/* throughput drift below -5% and resource growth above 5% over the run are flagged */
+static void soak_report( const double *times, const double *usage, const double *rates, int num_points )
+{
+     int    i, r = 0;
+     double drift;
 
-          /* create a surface using the description */
-          if (!surface)
-               DFBCHECK(dfb->CreateSurface( dfb, &dsc, &surface ));
+     if (num_points < 2) {
+          printf( "\nSoak run too short, at least two intervals are needed for a drift report.\n" );
+          return;
+     }
 
-          /* render the image to the created surface */
-          provider->RenderTo( provider, surface, NULL );
+     printf( output_csv ? "\ndrift,first,last,percent\n" : "\n%-44s %11s %11s %8s\n",
+             "Drift over the soak run", "first", "last", "drift" );
 
-          /* release the provider */
-          provider->Release( provider );
+     for (i = 0; i < num_demos; i++) {
+          if (!demos[i].requested)
+               continue;
+
+          drift = soak_drift( times, &rates[r], num_points, num_demos );
+
+          printf( output_csv ? "%s,%.3f,%.3f,%.1f%s\n" : "%-44.44s %11.3f %11.3f %7.1f%%%s\n", demos[i].desc,
+                  rates[r], rates[(num_points - 1) * num_demos + r], drift,
+                  drift < -5 ? (output_csv ? ",degraded" : "  DEGRADED") : "" );
+
+          r++;
+     }
+
+     for (i = 0; i < 3; i++) {
+          static const char *names[3] = { "RSS (KiB)", "Shared memory (KiB)", "File descriptors" };
+
+          if (usage[i] < 0)
+               continue;
+
+          drift = soak_drift( times, &usage[i], num_points, 3 );
+
+          printf( output_csv ? "%s,%.0f,%.0f,%.1f%s\n" : "%-44s %11.0f %11.0f %7.1f%%%s\n", names[i],
+                  usage[i], usage[(num_points - 1) * 3 + i], drift,
+                  drift > 5 ? (output_csv ? ",growing" : "  GROWING") : "" );
+     }
+}
+
+/*
+ * Cycle through the requested demos for soak_minutes, logging the throughput of each demo and the resource usage of
+ * the process every soak_interval seconds, then report the drift over the whole run.
+ */
+static void run_soak( void )
+{
+     int                i, r, num = 0, num_points = 0;
+     long long          start, next, end, now;
+     unsigned long long *ops;
+     long long          *elapsed;
+     double             *times = NULL;
+     double             *usage = NULL;
+     double             *rates = NULL;
+
+     ops     = D_CALLOC( num_demos, sizeof(unsigned long long) );
+     elapsed = D_CALLOC( num_demos, sizeof(long long) );
+     if (!ops || !elapsed) {
+          fprintf( stderr, "Out of memory!\n" );
+          exit( 1 );
+     }
+
+     for (i = 0; i < num_demos; i++) {
+          if (demos[i].requested && demo_setup( &demos[i] ))
+               num++;
+          else
+               demos[i].requested = 0;
+     }
+
+     if (output_csv) {
+          printf( "minutes,rss,shared,fds" );
+          for (i = 0; i < num_demos; i++) {
+               if (demos[i].requested)
+                    printf( ",%s", demos[i].desc );
+          }
+     }
+     else {
+          printf( "\n%8s %10s %10s %5s", "minutes", "RSS", "shared", "fds" );
+          for (i = 0; i < num_demos; i++) {
+               if (demos[i].requested)
+                    printf( " %11.11s", demos[i].option );
+          }
+     }
+
+     printf( "\n" );
+
+     start = direct_clock_get_millis();
+     next  = start + soak_interval * 1000LL;
+     end   = start + soak_minutes * 60000LL;
+
+     do {
+          for (i = 0; i < num_demos; i++) {
+               DemoSample sample;
+
+               if (!demos[i].requested)
+                    continue;
+
+               current_demo = &demos[i];
+
+               if (run_iteration( &demos[i], &sample )) {
+                    ops[i]     += sample.ops;
+                    elapsed[i] += sample.elapsed;
+               }
+          }
+
+          now = direct_clock_get_millis();
+
+          if (now >= next || now >= end) {
+               SoakUsage current;
+
+               if (!(num_points % 16)) {
+                    times = D_REALLOC( times, (num_points + 16) * sizeof(double) );
+                    usage = D_REALLOC( usage, (num_points + 16) * 3 * sizeof(double) );
+                    rates = D_REALLOC( rates, (num_points + 16) * num_demos * sizeof(double) );
+                    if (!times || !usage || !rates) {
+                         fprintf( stderr, "Out of memory!\n" );
+                         exit( 1 );
+                    }
+               }
+
+               soak_usage( &current );
+
+               times[num_points]         = (now - start) / 60000.0;
+               usage[num_points * 3]     = current.rss;
+               usage[num_points * 3 + 1] = current.shared;
+               usage[num_points * 3 + 2] = current.fds;
+
+               printf( output_csv ? "%.2f,%ld,%ld,%d" : "%8.2f %10ld %10ld %5d",
+                       times[num_points], current.rss, current.shared, current.fds );
+
+               for (i = 0, r = 0; i < num_demos; i++) {
+                    if (!demos[i].requested)
+                         continue;
+
+                    rates[num_points * num_demos + r] = elapsed[i] ? (double) ops[i] / elapsed[i] / 1000 : 0;
+
+                    printf( output_csv ? ",%.3f" : " %11.3f", rates[num_points * num_demos + r] );
+
+                    ops[i]     = 0;
+                    elapsed[i] = 0;
+
+                    r++;
+               }
+
+               printf( "\n" );
+               fflush( stdout );
+
+               num_points++;
+
+               next += soak_interval * 1000LL;
+          }
+     } while (now < end && num);
+
+     if (num)
+          soak_report( times, usage, rates, num_points );
+
+     for (i = 0; i < num_demos; i++) {
+          if (demos[i].requested)
+               demo_teardown( &demos[i] );
      }
 
-     if (surface)
-          surface->Release( surface );
+     if (times)
+          D_FREE( times );
+
+     if (usage)
+          D_FREE( usage );
 
-     snprintf( buf, sizeof(buf), " (%dx%d %s)", dsc.width, dsc.height, dfb_pixelformat_name( dsc.pixelformat ) );
-     strcat( current_demo->desc, buf );
+     if (rates)
+          D_FREE( rates );
 
-     return dsc.width * dsc.height * (unsigned long long) i;
+     D_FREE( elapsed );
+     D_FREE( ops );
 }
 
 /**********************************************************************************************************************/
@@ -1209,48 +6509,191 @@ int main( int argc, char *argv[] )
      DFBDataBufferDescription  ddsc;
      IDirectFBDataBuffer      *buffer;
      IDirectFBImageProvider   *provider;
-     DFBSurfaceRenderOptions   render_options = DSRO_NONE;
-     int                       demo_requested = 0;
+     int                       demo_requested      = 0;
+     bool                      plugin_dir_required = false;
 
      /* initialize DirectFB including command line parsing */
      DFBCHECK(DirectFBInit( &argc, &argv ));
 
+     add_porter_duff_demos();
+     add_stretch_demos();
+     add_yuv_demos();
+
+     /* load plug-ins first to make their benchmarks available as options */
+     for (n = 1; n < argc - 1; n++) {
+          if (strcmp( argv[n], "--plugin-dir" ) == 0) {
+               plugin_dir          = argv[n+1];
+               plugin_dir_required = true;
+          }
+     }
+
+     if (plugin_dir && *plugin_dir)
+          load_plugins( plugin_dir, plugin_dir_required );
+
      /* parse command line */
      for (n = 1; n < argc; n++) {
           if (strncmp( argv[n], "--", 2 ) == 0) {
-               for (i = 0; i < D_ARRAY_SIZE(demos); i++) {
+               for (i = 0; i < num_demos; i++) {
                     if (strcmp( argv[n] + 2, demos[i].option ) == 0) {
                          demo_requested = 1;
-                         demos[i].requested = 1;
-                         break;
-                    }
-               }
-
-               if (i == D_ARRAY_SIZE(demos)) {
-                    if (strcmp( argv[n] + 2, "help" ) == 0) {
-                         print_usage();
-                         return 0;
+                         demos[i].requested = 1;
+                         break;
+                    }
+               }
+
+               if (i == num_demos) {
+                    if (strcmp( argv[n] + 2, "help" ) == 0) {
+                         print_usage();
+                         return 0;
+                    } else
+                    if (strcmp( argv[n] + 2, "duration" ) == 0 && n + 1 < argc &&
+                        sscanf( argv[n+1], "%d", &DEMOTIME ) == 1) {
+                         n++;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "iterations" ) == 0 && n + 1 < argc &&
+                        sscanf( argv[n+1], "%d", &ITERATIONS ) == 1) {
+                         n++;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "warmup" ) == 0 && n + 1 < argc &&
+                        sscanf( argv[n+1], "%d", &WARMUP ) == 1) {
+                         n++;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "converge" ) == 0 && n + 1 < argc &&
+                        sscanf( argv[n+1], "%f", &converge ) == 1) {
+                         n++;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "max-time" ) == 0 && n + 1 < argc &&
+                        sscanf( argv[n+1], "%d", &MAXTIME ) == 1) {
+                         n++;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "size" ) == 0 && n + 1 < argc &&
+                        sscanf( argv[n+1], "%dx%d", &SX, &SY ) == 2) {
+                         n++;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "ui-size" ) == 0 && n + 1 < argc &&
+                        sscanf( argv[n+1], "%dx%d", &ui_width, &ui_height ) == 2) {
+                         n++;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "pixelformat" ) == 0 && n + 1 < argc) {
+                         pixelformat = parse_pixelformat( argv[n+1] );
+                         n++;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "pixelformat-sweep" ) == 0) {
+                         format_sweep = 1;
+                         if (n + 1 < argc && strncmp( argv[n+1], "--", 2 ))
+                              sweep_formats = argv[++n];
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "porter-duff" ) == 0) {
+                         format_sweep  = 1;
+                         sweep_formats = PD_FORMATS;
+                         if (n + 1 < argc && strncmp( argv[n+1], "--", 2 ))
+                              sweep_formats = argv[++n];
+                         for (i = 0; i < num_demos; i++) {
+                              if (demos[i].func == blit_porter_duff)
+                                   demos[i].requested = 1;
+                         }
+                         demo_requested = 1;
+                         continue;
                     } else
-                    if (strcmp( argv[n] + 2, "duration" ) == 0 && n + 1 < argc &&
-                        sscanf( argv[n+1], "%d", &DEMOTIME ) == 1) {
+                    if (strcmp( argv[n] + 2, "stretch-sweep" ) == 0) {
+                         for (i = 0; i < num_demos; i++) {
+                              if (demos[i].func == stretch_ratio)
+                                   demos[i].requested = 1;
+                         }
+                         demo_requested = 1;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "yuv" ) == 0) {
+                         for (i = 0; i < num_demos; i++) {
+                              if (demos[i].func == blit_yuv)
+                                   demos[i].requested = 1;
+                         }
+                         demo_requested = 1;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "cold" ) == 0) {
+                         char unit = 0;
+
+                         cold_budget = -1;
+                         if (n + 1 < argc && sscanf( argv[n+1], "%lld%c", &cold_budget, &unit ) >= 1) {
+                              cold_budget *= unit == 'K' ? 1024LL : unit == 'M' ? 1024LL * 1024 :
+                                             unit == 'G' ? 1024LL * 1024 * 1024 : 1;
+                              n++;
+                         }
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "align-sweep" ) == 0) {
+                         align_sweep = 1;
+                         if (n + 1 < argc && strcmp( argv[n+1], "dest" ) == 0)
+                              n++;
+                         else if (n + 1 < argc && strcmp( argv[n+1], "source" ) == 0) {
+                              align_sweep = 2;
+                              n++;
+                         }
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "pitch-pad" ) == 0 && n + 1 < argc &&
+                        sscanf( argv[n+1], "%d", &pitch_pad ) == 1) {
+                         pitch_pad = MAX( pitch_pad, 0 );
                          n++;
                          continue;
                     } else
-                    if (strcmp( argv[n] + 2, "iterations" ) == 0 && n + 1 < argc &&
-                        sscanf( argv[n+1], "%d", &ITERATIONS ) == 1) {
+                    if (strcmp( argv[n] + 2, "size-sweep" ) == 0) {
+                         size_sweep = 1;
+                         if (n + 1 < argc && sscanf( argv[n+1], "%d-%d", &sweep_min, &sweep_max ) >= 1)
+                              n++;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "batch" ) == 0 && n + 1 < argc &&
+                        sscanf( argv[n+1], "%d", &batch_size ) == 1) {
+                         batch_size = CLAMP( batch_size, 1, BENCH_BATCH_MAX );
                          n++;
                          continue;
                     } else
-                    if (strcmp( argv[n] + 2, "size" ) == 0 && n + 1 < argc &&
-                        sscanf( argv[n+1], "%dx%d", &SX, &SY ) == 2) {
+                    if (strcmp( argv[n] + 2, "plugin-dir" ) == 0 && ++n < argc) {
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "trace" ) == 0 && ++n < argc) {
+                         trace_filename = argv[n];
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "trace-calls" ) == 0) {
+                         trace_calls = 1;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "soak" ) == 0 && n + 1 < argc &&
+                        sscanf( argv[n+1], "%d", &soak_minutes ) == 1) {
                          n++;
                          continue;
                     } else
-                    if (strcmp( argv[n] + 2, "pixelformat" ) == 0 && n + 1 < argc) {
-                         pixelformat = parse_pixelformat( argv[n+1] );
+                    if (strcmp( argv[n] + 2, "soak-interval" ) == 0 && n + 1 < argc &&
+                        sscanf( argv[n+1], "%d", &soak_interval ) == 1) {
+                         if (soak_interval < 1)
+                              soak_interval = 1;
                          n++;
                          continue;
                     } else
+                    if (strcmp( argv[n] + 2, "drain" ) == 0) {
+                         show_drain = 1;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "perf" ) == 0) {
+                         do_perf = 1;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "load-fresh" ) == 0) {
+                         load_fresh = 1;
+                         continue;
+                    } else
                     if (strcmp( argv[n] + 2, "system" ) == 0) {
                          do_system = 1;
                          continue;
@@ -1259,6 +6702,19 @@ int main( int argc, char *argv[] )
                          do_dump = 1;
                          continue;
                     } else
+                    if (strcmp( argv[n] + 2, "dump-format" ) == 0 && n + 1 < argc) {
+                         for (i = 0; i < D_ARRAY_SIZE(dump_format_names); i++) {
+                              if (!strcmp( argv[n+1], dump_format_names[i] ))
+                                   break;
+                         }
+
+                         if (i < D_ARRAY_SIZE(dump_format_names)) {
+                              dump_format = i;
+                              do_dump     = 1;
+                              n++;
+                              continue;
+                         }
+                    } else
                     if (strcmp( argv[n] + 2, "wait" ) == 0 && n + 1 < argc &&
                         sscanf( argv[n+1], "%d", &do_wait ) == 1) {
                          n++;
@@ -1300,6 +6756,34 @@ int main( int argc, char *argv[] )
                          output_csv = 1;
                          continue;
                     } else
+                    if (strcmp( argv[n] + 2, "json" ) == 0 && ++n < argc) {
+                         json_filename = argv[n];
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "threads" ) == 0 && n + 1 < argc &&
+                        sscanf( argv[n+1], "%d", &num_threads ) == 1) {
+                         if (num_threads < 1)
+                              num_threads = sysconf( _SC_NPROCESSORS_ONLN );
+                         n++;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "verify" ) == 0 && ++n < argc) {
+                         verify_filename = argv[n];
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "verify-ops" ) == 0 && n + 1 < argc &&
+                        sscanf( argv[n+1], "%d", &verify_ops ) == 1) {
+                         n++;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "latency" ) == 0) {
+                         latency_batch = 1;
+                         if (n + 1 < argc && sscanf( argv[n+1], "%d", &latency_batch ) == 1)
+                              n++;
+                         if (latency_batch < 1)
+                              latency_batch = 1;
+                         continue;
+                    } else
                     if (strcmp( argv[n] + 2, "fullscreen" ) == 0) {
                          run_fullscreen = 1;
                          continue;
@@ -1309,9 +6793,16 @@ int main( int argc, char *argv[] )
                          continue;
                     } else
                     if (strcmp( argv[n] + 2, "load-image" ) == 0 && ++n < argc) {
-                         filename = argv[n];
+                         add_image_path( argv[n] );
+                         demo_requested = 1;
+                         demos[D_ARRAY_SIZE(builtin_demos)-2].requested = 1;
+                         continue;
+                    } else
+                    if (strcmp( argv[n] + 2, "replay" ) == 0 && ++n < argc) {
+                         if (!replay_load( argv[n] ))
+                              return 1;
                          demo_requested = 1;
-                         demos[D_ARRAY_SIZE(demos)-1].requested = 1;
+                         demos[D_ARRAY_SIZE(builtin_demos)-1].requested = 1;
                          continue;
                     }
                }
@@ -1324,8 +6815,43 @@ int main( int argc, char *argv[] )
           return 1;
      }
 
+     if ((format_sweep != 0) + (size_sweep != 0) + (align_sweep != 0) > 1) {
+          fprintf( stderr, "Only one of --pixelformat-sweep (also used by --porter-duff), --size-sweep and "
+                   "--align-sweep can be used!\n" );
+          return 1;
+     }
+
+     /* one warm-up round by default when converging */
+     if (WARMUP < 0)
+          WARMUP = converge ? 1 : 0;
+
+     /* short samples when converging, otherwise the minimum of a warm-up and three samples exceeds a fixed run */
+     SAMPLETIME = converge ? MAX( DEMOTIME / 10, 100 ) : DEMOTIME;
+
+     if (trace_filename)
+          direct_mutex_init( &trace_lock );
+
+     if (cold_budget < 0)
+          cold_budget = 4 * llc_size();
+
+     if (cold_budget)
+          direct_mutex_init( &cold_lock );
+
+     if (do_perf && !perf_open()) {
+          fprintf( stderr, "Performance counters are not available, continuing without them.\n" );
+          do_perf = 0;
+     }
+
+     /* show the batch size in the description of batched benchmarks */
+     for (i = 0; i < num_demos; i++) {
+          char *batch = strstr( demos[i].desc, "[n]" );
+
+          if (batch)
+               snprintf( batch, sizeof(demos[i].desc) - (batch - demos[i].desc), "[%d]", batch_size );
+     }
+
      if (!demo_requested || do_all_demos) {
-          for (i = 0; i < D_ARRAY_SIZE(demos); i++)
+          for (i = 0; i < num_demos; i++)
                demos[i].requested = (demos[i].default_on || do_all_demos);
      }
 
@@ -1440,150 +6966,8 @@ int main( int argc, char *argv[] )
      provider->RenderTo( provider, cardicon, NULL );
      provider->Release( provider );
 
-     /* create a surface and render an image to it */
-#ifdef USE_IMAGE_HEADERS
-     ddsc.flags         = DBDESC_MEMORY;
-     ddsc.memory.data   = GET_IMAGEDATA( swirl );
-     ddsc.memory.length = GET_IMAGESIZE( swirl );
-#else
-     ddsc.flags         = DBDESC_FILE;
-     ddsc.file          = GET_IMAGEFILE( swirl );
-#endif
-     DFBCHECK(dfb->CreateDataBuffer( dfb, &ddsc, &buffer ));
-     DFBCHECK(buffer->CreateImageProvider( buffer, &provider ));
-     buffer->Release( buffer );
-     provider->GetSurfaceDescription( provider, &sdsc );
-     sdsc.width       = SX * 2;
-     sdsc.height      = SY * 2;
-     sdsc.pixelformat = pixelformat;
-     DFBCHECK(dfb->CreateSurface( dfb, &sdsc, &swirl ));
-     provider->RenderTo( provider, swirl, NULL );
-     provider->Release( provider );
-
-     /* create a surface and render an image to it */
-#ifdef USE_IMAGE_HEADERS
-     ddsc.flags         = DBDESC_MEMORY;
-     ddsc.memory.data   = GET_IMAGEDATA( rose );
-     ddsc.memory.length = GET_IMAGESIZE( rose );
-#else
-     ddsc.flags         = DBDESC_FILE;
-     ddsc.file          = GET_IMAGEFILE( rose );
-#endif
-     DFBCHECK(dfb->CreateDataBuffer( dfb, &ddsc, &buffer ));
-     DFBCHECK(buffer->CreateImageProvider( buffer, &provider ));
-     buffer->Release( buffer );
-     provider->GetSurfaceDescription( provider, &sdsc );
-     sdsc.width       = SX;
-     sdsc.height      = SY;
-     sdsc.pixelformat = DSPF_ARGB;
-     DFBCHECK(dfb->CreateSurface( dfb, &sdsc, &rose ));
-     provider->RenderTo( provider, rose, NULL );
-     sdsc.flags      |= DSDESC_CAPS;
-     sdsc.caps        = DSCAPS_PREMULTIPLIED;
-     DFBCHECK(dfb->CreateSurface( dfb, &sdsc, &rose_pre ));
-     provider->RenderTo( provider, rose_pre, NULL );
-     provider->Release( provider );
-
-     /* create a surface and render an image to it */
-#ifdef USE_IMAGE_HEADERS
-     ddsc.flags         = DBDESC_MEMORY;
-     ddsc.memory.data   = GET_IMAGEDATA( melted );
-     ddsc.memory.length = GET_IMAGESIZE( melted );
-#else
-     ddsc.flags         = DBDESC_FILE;
-     ddsc.file          = GET_IMAGEFILE( melted );
-#endif
-     DFBCHECK(dfb->CreateDataBuffer( dfb, &ddsc, &buffer ));
-     DFBCHECK(buffer->CreateImageProvider( buffer, &provider ));
-     buffer->Release( buffer );
-     provider->GetSurfaceDescription( provider, &sdsc );
-     sdsc.width       = SX;
-     sdsc.height      = SY;
-     sdsc.pixelformat = pixelformat;
-     DFBCHECK(dfb->CreateSurface( dfb, &sdsc, &simple ));
-     provider->RenderTo( provider, simple, NULL );
-     provider->Release( provider );
-
-     /* create a surface and render an image to it */
-#ifdef USE_IMAGE_HEADERS
-     ddsc.flags         = DBDESC_MEMORY;
-     ddsc.memory.data   = GET_IMAGEDATA( colorkeyed );
-     ddsc.memory.length = GET_IMAGESIZE( colorkeyed );
-#else
-     ddsc.flags         = DBDESC_FILE;
-     ddsc.file          = GET_IMAGEFILE( colorkeyed );
-#endif
-     DFBCHECK(dfb->CreateDataBuffer( dfb, &ddsc, &buffer ));
-     DFBCHECK(buffer->CreateImageProvider( buffer, &provider ));
-     buffer->Release( buffer );
-     provider->GetSurfaceDescription( provider, &sdsc );
-     sdsc.width       = SX;
-     sdsc.height      = SY;
-     sdsc.pixelformat = pixelformat;
-     DFBCHECK(dfb->CreateSurface( dfb, &sdsc, &colorkeyed ));
-     provider->RenderTo( provider, colorkeyed, NULL );
-     DFBCHECK(colorkeyed->SetSrcColorKey( colorkeyed, 0x06, 0x18, 0xF4 ));
-     provider->Release( provider );
-
-     /* create a surface and render an image to it */
-#ifdef USE_IMAGE_HEADERS
-     ddsc.flags         = DBDESC_MEMORY;
-     ddsc.memory.data   = GET_IMAGEDATA( laden_bike );
-     ddsc.memory.length = GET_IMAGESIZE( laden_bike );
-#else
-     ddsc.flags         = DBDESC_FILE;
-     ddsc.file          = GET_IMAGEFILE( laden_bike );
-#endif
-     DFBCHECK(dfb->CreateDataBuffer( dfb, &ddsc, &buffer ));
-     DFBCHECK(buffer->CreateImageProvider( buffer, &provider ));
-     buffer->Release( buffer );
-     provider->GetSurfaceDescription( provider, &sdsc );
-     sdsc.width       = SX;
-     sdsc.height      = SY;
-     sdsc.pixelformat = DFB_BYTES_PER_PIXEL( pixelformat ) == 2 ? DSPF_RGB32 : DSPF_RGB16;
-     DFBCHECK(dfb->CreateSurface( dfb, &sdsc, &image32 ));
-     provider->RenderTo( provider, image32, NULL );
-     provider->Release( provider );
-
-     /* create a surface and render an image to it */
-#ifdef USE_IMAGE_HEADERS
-     ddsc.flags         = DBDESC_MEMORY;
-     ddsc.memory.data   = GET_IMAGEDATA( sacred_heart );
-     ddsc.memory.length = GET_IMAGESIZE( sacred_heart );
-#else
-     ddsc.flags         = DBDESC_FILE;
-     ddsc.file          = GET_IMAGEFILE( sacred_heart );
-#endif
-     DFBCHECK(dfb->CreateDataBuffer( dfb, &ddsc, &buffer ));
-     DFBCHECK(buffer->CreateImageProvider( buffer, &provider ));
-     buffer->Release( buffer );
-     provider->GetSurfaceDescription( provider, &sdsc );
-     sdsc.width       = SX;
-     sdsc.height      = SY;
-     sdsc.pixelformat = DSPF_ARGB;
-     DFBCHECK(dfb->CreateSurface( dfb, &sdsc, &image32a ));
-     provider->RenderTo( provider, image32a, NULL );
-     provider->Release( provider );
-
-     /* create a surface and render an image to it */
-#ifdef USE_IMAGE_HEADERS
-     ddsc.flags         = DBDESC_MEMORY;
-     ddsc.memory.data   = GET_IMAGEDATA( fish );
-     ddsc.memory.length = GET_IMAGESIZE( fish );
-#else
-     ddsc.flags         = DBDESC_FILE;
-     ddsc.file          = GET_IMAGEFILE( fish );
-#endif
-     DFBCHECK(dfb->CreateDataBuffer( dfb, &ddsc, &buffer ));
-     DFBCHECK(buffer->CreateImageProvider( buffer, &provider ));
-     buffer->Release( buffer );
-     provider->GetSurfaceDescription( provider, &sdsc );
-     sdsc.width       = SX;
-     sdsc.height      = SY;
-     sdsc.pixelformat = DSPF_A8;
-     DFBCHECK(dfb->CreateSurface( dfb, &sdsc, &image8a ));
-     provider->RenderTo( provider, image8a, NULL );
-     provider->Release( provider );
+     /* test images */
+     DFBCHECK(create_images());
 
      /* intro screen */
      if (with_intro) {
@@ -1609,160 +6993,68 @@ int main( int argc, char *argv[] )
      printf( "Benchmarking %dx%d on %dx%d %s (%dbit)...\n",
              SX, SY, SW, SH, dfb_pixelformat_name( pixelformat ), DFB_BYTES_PER_PIXEL( pixelformat ) * 8 );
 
-     if (do_system) {
-          sdsc.flags       = DSDESC_WIDTH | DSDESC_HEIGHT | DSDESC_PIXELFORMAT | DSDESC_CAPS;
-          sdsc.width       = SW;
-          sdsc.height      = SH;
-          sdsc.pixelformat = pixelformat;
-          sdsc.caps        = DSCAPS_SYSTEMONLY;
-
-          DFBCHECK(dfb->CreateSurface( dfb, &sdsc, &dest ));
-
-          dest->Clear( dest, 0, 0, 0, 0x80 );
-     }
-     else {
-          DFBRectangle rect = { 0, 0, SW, SH };
-
-          DFBCHECK(primary->GetSubSurface( primary, &rect, &dest ));
-     }
-
-     if (do_noaccel)
-          dest->DisableAcceleration( dest, DFXL_ALL );
-
-     dest->SetFont( dest, bench_font );
+     dest = create_dest( false );
 
-     if (do_smooth)
-          render_options |= DSRO_SMOOTH_UPSCALE | DSRO_SMOOTH_DOWNSCALE;
-
-     if (do_aa)
-          render_options |= DSRO_ANTIALIAS;
-
-     if (do_matrix) {
-          const s32 matrix[9] = { 0x01000, 0x19F00, 0x00000,
-                                  0x08A00, 0x01000, 0x00000,
-                                  0x00000, 0x00000, 0x10000 };
+     if (verify_filename)
+          load_references( verify_filename );
 
-          dest->SetMatrix( dest, matrix );
+     harness_overhead = measure_overhead();
 
-          render_options |= DSRO_MATRIX;
-     }
+     if (!output_csv)
+          printf( "Harness overhead is %.1f nsecs per operation.\n", harness_overhead );
 
-     dest->SetRenderOptions( dest, render_options );
+     if (cold_budget)
+          printf( "Blit sources rotate through copies of more than %lld KB.\n", cold_budget / 1024 );
 
      direct_sync();
 
 run:
-     for (i = 0; i < D_ARRAY_SIZE(demos); i++) {
-           int j, skip;
-
-           if (!demos[i].requested)
-                continue;
-
-           current_demo = &demos[i];
-
-           skip = 0;
-
-           for (j = 0; j < ITERATIONS; j++) {
-                long               perf;
-                long long          t, dt, t1, t2;
-                unsigned long long pixels;
-
-                showMessage( demos[i].message );
-
-                showStatus( demos[i].status );
-
-                /* Get ready... */
-                direct_sync();
-                dfb->WaitIdle( dfb );
-
-                /* Take start... */
-                t1 = process_time();
-                t = direct_clock_get_millis();
-
-                /* Go... */
-                pixels = demos[i].func( t );
-
-                /* Wait... */
-                dfb->WaitIdle( dfb );
-
-                /* Take stop... */
-                dt = direct_clock_get_millis() - t;
-                t2 = process_time();
-
-                if (!pixels || !dt) {
-                     skip = 1;
-                     break;
-                }
-
-                primary->Flip( primary, NULL, DSFLIP_NONE );
-
-                perf = pixels / dt;
-                if (perf > demos[i].result) {
-                     demos[i].result   = perf;
-                     demos[i].load     = (t2 - t1) * 1000 / (ticks_per_second() * dt / 1000);
-                     demos[i].duration = dt;
-                }
-           }
-
-           if (skip)
-                continue;
-
-           if (output_csv) {
-                printf( "%s%s%s,%ld.%.3ld,%s,%ld.%.3ld,%s,%d.%d\n",
-                        do_aa ? "AA " : "",
-                        do_matrix ? "MX " : "",
-                        demos[i].desc, demos[i].duration / 1000, demos[i].duration % 1000,
-                        demos[i].accelerated ? "*" : " ",
-                        demos[i].result / 1000, demos[i].result % 1000, demos[i].unit,
-                        demos[i].load / 10, demos[i].load % 10 );
-           }
-           else {
-                printf( "%s%s%-44s %3ld.%.3ld secs (%s%4ld.%.3ld %s) [%3d.%d%%]\n",
-                        do_aa ? "AA " : "",
-                        do_matrix ? "MX " : "",
-                        demos[i].desc, demos[i].duration / 1000, demos[i].duration % 1000,
-                        demos[i].accelerated ? "*" : " ",
-                        demos[i].result / 1000, demos[i].result % 1000, demos[i].unit,
-                        demos[i].load / 10, demos[i].load % 10 );
-           }
-
-           if (do_system) {
-                primary->SetBlittingFlags( primary, DSBLIT_NOFX );
-                primary->Blit( primary, dest, NULL, 0, 0 );
-                sleep( 2 );
-                dest->Clear( dest, 0, 0, 0, 0x80 );
-           }
-
-           if (do_dump) {
-                int  index = 0;
-                char buf[200];
-
-                snprintf( buf, sizeof(buf), "DirectFB_%s%s%.127s",
-                          do_aa ? "AA " : "", do_matrix ? "MX " : "", demos[i].desc );
+     if (format_sweep) {
+          run_format_sweep();
+     }
+     else if (size_sweep) {
+          run_size_sweep();
+     }
+     else if (align_sweep) {
+          run_align_sweep();
+     }
+     else if (soak_minutes) {
+          run_soak();
+     }
+     else {
+          for (i = 0; i < num_demos; i++) {
+               if (demos[i].requested)
+                    run_demo( &demos[i] );
+          }
+     }
 
-                while (buf[index]) {
-                     if (buf[index] == ' ')
-                          buf[index] = '_';
+     /* write pending dumps */
+     dump_finish();
 
-                     index++;
-                }
+     /* machine-readable results */
+     if (json_filename)
+          write_json( json_filename );
 
-                primary->Dump( primary, ".", buf );
-           }
+     if (verify_filename && references_changed) {
+          save_references( verify_filename );
 
-           if (do_wait)
-                sleep( do_wait );
+          references_changed = false;
      }
 
      /* results screen */
+     if (trace_filename)
+          write_trace( trace_filename );
+
      if (show_results)
           showResult();
 
      event_buffer->GetEvent( event_buffer, DFB_EVENT(&evt) );
 
      if (evt.key_id == DIKI_HOME || evt.key_id == DIKI_ENTER) {
-          for (i = 0; i < D_ARRAY_SIZE(demos); i++)
-               demos[i].result = 0;
+          for (i = 0; i < num_demos; i++) {
+               demos[i].result      = 0;
+               demos[i].num_samples = 0;
+          }
 
           sleep( 1 );
 
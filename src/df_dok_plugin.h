@@ -0,0 +1,77 @@
+/*
+   This file is part of DirectFB-examples.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef __DF_DOK_PLUGIN_H__
+#define __DF_DOK_PLUGIN_H__
+
+#include <directfb.h>
+
+/*
+ * Benchmark plug-ins for df_dok.
+ *
+ * A plug-in is a shared object in the plug-in directory exporting DF_DOK_PLUGIN_INIT, which returns an array of
+ * benchmarks. These are run like the built-in ones: they can be selected with --<option>, take part in iterations,
+ * sweeps, threads, CSV/JSON output and the results screen.
+ */
+
+#define DF_DOK_PLUGIN_ABI_VERSION 1
+
+#define DF_DOK_PLUGIN_INIT        "df_dok_plugin_init"
+
+typedef struct {
+     IDirectFB             *dfb;
+     IDirectFBSurface      *dest;           /* destination of the calling thread, valid during run() */
+     int                    width;          /* benchmark size */
+     int                    height;
+     int                    screen_width;   /* size of the destination */
+     int                    screen_height;
+     DFBSurfacePixelFormat  pixelformat;    /* benchmark pixelformat */
+
+     /* loop condition, i is the number of operations issued so far and t the start time passed to run() */
+     bool                 (*running)    ( long i, long long t );
+
+     /* mark the benchmark as accelerated, returns false if it must be skipped */
+     bool                 (*accelerated)( DFBAccelerationMask func, IDirectFBSurface *source );
+} DFDokContext;
+
+typedef struct {
+     const char            *desc;           /* shown in the results */
+     const char            *message;        /* shown before running */
+     const char            *status;         /* shown in the status bar while running */
+     const char            *option;         /* command line option without the leading "--" */
+     const char            *unit;           /* e.g. "MPixel/sec" */
+     bool                   default_on;     /* run if no benchmark is selected */
+
+     /* optional, called with the current size and pixelformat before the benchmark runs */
+     DFBResult            (*setup)   ( const DFDokContext *ctx, void **data );
+
+     /* issue operations while running() returns true, return the amount of work done (e.g. pixels for MPixel/sec) */
+     unsigned long long   (*run)     ( const DFDokContext *ctx, void *data, long long t );
+
+     /* optional, called after the benchmark has run */
+     void                 (*teardown)( const DFDokContext *ctx, void *data );
+} DFDokBenchmark;
+
+/* returns the benchmarks of the plug-in or NULL if abi_version is not supported */
+typedef const DFDokBenchmark *(*DFDokPluginInitFunc)( unsigned int abi_version, int *num_benchmarks );
+
+#endif
@@ -0,0 +1,755 @@
+/*
+   This file is part of DirectFB-examples.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef __DF_DOK_RECORD_H__
+#define __DF_DOK_RECORD_H__
+
+#include <directfb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Recording of IDirectFBSurface call streams for replay with 'df_dok --replay <filename>'.
+ *
+ * An application includes this header and calls df_dok_record_start() after DirectFBCreate(). All surfaces created
+ * afterwards, their sub-surfaces and surfaces passed to df_dok_record_surface() are recorded: state changes including
+ * blend functions, matrix, color key indices and source mask, drawing and blitting operations and flips, which mark
+ * the end of a frame. The content of a blit source or source mask is stored the first time it is used. Text,
+ * textured triangles and direct access via Lock() are not recorded. Recording is not thread safe.
+ *
+ * A trace is the 8 byte magic DFDOK_RECORD_MAGIC, a u32 version and a sequence of records, each a DFDokRecordHeader
+ * followed by 'size' bytes of payload in native byte order, padded to a multiple of 4 bytes.
+ */
+
+#define DFDOK_RECORD_MAGIC   "DFBTRACE"
+#define DFDOK_RECORD_VERSION 1
+
+typedef enum {
+     DFDOK_OP_CREATE,                 /* DFDokRecordCreate */
+     DFDOK_OP_SUBSURFACE,             /* DFDokRecordSubSurface */
+     DFDOK_OP_DATA,                   /* DFDokRecordData followed by pitch * rows bytes */
+     DFDOK_OP_CLEAR,                  /* DFDokRecordColor */
+     DFDOK_OP_SET_COLOR,              /* DFDokRecordColor */
+     DFDOK_OP_SET_SRC_COLORKEY,       /* DFDokRecordColor */
+     DFDOK_OP_SET_DST_COLORKEY,       /* DFDokRecordColor */
+     DFDOK_OP_SET_DRAWING_FLAGS,      /* u32 */
+     DFDOK_OP_SET_BLITTING_FLAGS,     /* u32 */
+     DFDOK_OP_SET_PORTER_DUFF,        /* u32 */
+     DFDOK_OP_SET_RENDER_OPTIONS,     /* u32 */
+     DFDOK_OP_SET_CLIP,               /* DFDokRecordRegion */
+     DFDOK_OP_FILL_RECTANGLES,        /* DFBRectangle[] */
+     DFDOK_OP_DRAW_RECTANGLE,         /* DFBRectangle */
+     DFDOK_OP_DRAW_LINES,             /* DFBRegion[] */
+     DFDOK_OP_FILL_TRIANGLES,         /* DFBTriangle[] */
+     DFDOK_OP_FILL_SPANS,             /* s32 y followed by DFBSpan[] */
+     DFDOK_OP_FILL_TRAPEZOIDS,        /* DFBTrapezoid[] */
+     DFDOK_OP_BLIT,                   /* DFDokRecordBlit */
+     DFDOK_OP_TILE_BLIT,              /* DFDokRecordBlit */
+     DFDOK_OP_STRETCH_BLIT,           /* DFDokRecordStretchBlit */
+     DFDOK_OP_BATCH_BLIT,             /* u32 source followed by DFBRectangle[] and DFBPoint[] */
+     DFDOK_OP_BATCH_STRETCH_BLIT,     /* u32 source followed by source and destination DFBRectangle[] */
+     DFDOK_OP_FLIP,                   /* DFDokRecordRegion, end of a frame */
+     DFDOK_OP_SET_SRC_BLEND_FUNCTION, /* u32 */
+     DFDOK_OP_SET_DST_BLEND_FUNCTION, /* u32 */
+     DFDOK_OP_SET_MATRIX,             /* s32[9] */
+     DFDOK_OP_SET_SRC_COLORKEY_INDEX, /* u32 */
+     DFDOK_OP_SET_DST_COLORKEY_INDEX, /* u32 */
+     DFDOK_OP_SET_SOURCE_MASK,        /* DFDokRecordSourceMask */
+     DFDOK_NUM_OPS
+} DFDokRecordOp;
+
+typedef struct {
+     u8                   op;
+     u8                   reserved;
+     u16                  surface;    /* id of the surface the operation is called on */
+     u32                  size;       /* of the payload */
+} DFDokRecordHeader;
+
+typedef struct {
+     s32                  width;
+     s32                  height;
+     u32                  format;     /* DFBSurfacePixelFormat */
+     u32                  caps;       /* DFBSurfaceCapabilities */
+} DFDokRecordCreate;
+
+typedef struct {
+     u32                  parent;
+     DFBRectangle         rect;
+} DFDokRecordSubSurface;
+
+typedef struct {
+     s32                  pitch;
+     s32                  rows;
+} DFDokRecordData;
+
+typedef struct {
+     u8                   r, g, b, a;
+} DFDokRecordColor;
+
+typedef struct {
+     s32                  valid;      /* 0 if the region pointer was NULL */
+     DFBRegion            region;
+     u32                  flags;      /* DFBSurfaceFlipFlags */
+} DFDokRecordRegion;
+
+typedef struct {
+     u32                  source;
+     s32                  valid;      /* 0 if the source rectangle pointer was NULL */
+     DFBRectangle         rect;
+     s32                  x, y;
+} DFDokRecordBlit;
+
+typedef struct {
+     u32                  source;
+     s32                  valid;      /* bit 0 for the source, bit 1 for the destination rectangle */
+     DFBRectangle         source_rect;
+     DFBRectangle         dest_rect;
+} DFDokRecordStretchBlit;
+
+typedef struct {
+     u32                  mask;       /* 0xFFFFFFFF if the mask pointer was NULL */
+     s32                  x, y;
+     u32                  flags;      /* DFBSurfaceMaskFlags */
+} DFDokRecordSourceMask;
+
+/**********************************************************************************************************************/
+
+typedef struct {
+     IDirectFBSurface    *surface;
+     IDirectFBSurface     funcs;      /* original functions */
+     bool                 has_data;   /* content has been recorded */
+} DFDokRecordSurface;
+
+static FILE               *dfdok_record_file         = NULL;
+static DFDokRecordSurface *dfdok_record_surfaces     = NULL;
+static int                 dfdok_record_num_surfaces = 0;
+static IDirectFB          *dfdok_record_dfb          = NULL;
+static DFBResult         (*dfdok_record_create)( IDirectFB *thiz, const DFBSurfaceDescription *desc,
+                                                 IDirectFBSurface **ret_interface );
+
+static inline int dfdok_record_lookup( IDirectFBSurface *surface )
+{
+     int i;
+
+     for (i = dfdok_record_num_surfaces - 1; i >= 0; i--) {
+          if (dfdok_record_surfaces[i].surface == surface)
+               return i;
+     }
+
+     return -1;
+}
+
+static inline bool dfdok_record_header( DFDokRecordOp op, int id, u32 size )
+{
+     DFDokRecordHeader header;
+
+     if (!dfdok_record_file || id < 0)
+          return false;
+
+     header.op       = op;
+     header.reserved = 0;
+     header.surface  = id;
+     header.size     = size;
+
+     fwrite( &header, sizeof(header), 1, dfdok_record_file );
+
+     return true;
+}
+
+static inline void dfdok_record_write( DFDokRecordOp op, int id, const void *data, u32 size,
+                                       const void *data2, u32 size2 )
+{
+     if (!dfdok_record_header( op, id, size + size2 ))
+          return;
+
+     if (size)
+          fwrite( data, size, 1, dfdok_record_file );
+
+     if (size2)
+          fwrite( data2, size2, 1, dfdok_record_file );
+}
+
+#define DFDOK_RECORD_THIZ(thiz)  (&dfdok_record_surfaces[dfdok_record_lookup( thiz )].funcs)
+
+static int dfdok_record_add( IDirectFBSurface *surface );
+
+/* id of a blit source, registered and with its content recorded on first use */
+static inline int dfdok_record_source( IDirectFBSurface *source )
+{
+     int                 id = dfdok_record_add( source );
+     DFDokRecordSurface *entry;
+     DFDokRecordData     data;
+     void               *ptr;
+     int                 pitch, y, w, h;
+     DFBSurfacePixelFormat format;
+
+     if (id < 0)
+          return -1;
+
+     entry = &dfdok_record_surfaces[id];
+
+     if (entry->has_data)
+          return id;
+
+     entry->has_data = true;
+
+     entry->funcs.GetSize( source, &w, &h );
+     entry->funcs.GetPixelFormat( source, &format );
+
+     data.pitch = DFB_BYTES_PER_LINE( format, w );
+     data.rows  = DFB_PLANE_MULTIPLY( format, h );
+
+     if (entry->funcs.Lock( source, DSLF_READ, &ptr, &pitch ))
+          return id;
+
+     dfdok_record_header( DFDOK_OP_DATA, id, sizeof(data) + data.pitch * data.rows );
+
+     fwrite( &data, sizeof(data), 1, dfdok_record_file );
+
+     for (y = 0; y < data.rows; y++)
+          fwrite( (u8*) ptr + y * pitch, data.pitch, 1, dfdok_record_file );
+
+     entry->funcs.Unlock( source );
+
+     /* pad the record */
+     fwrite( "\0\0\0", (4 - (data.pitch * data.rows) % 4) % 4, 1, dfdok_record_file );
+
+     return id;
+}
+
+static DFBResult dfdok_record_Clear( IDirectFBSurface *thiz, u8 r, u8 g, u8 b, u8 a )
+{
+     DFDokRecordColor color = { r, g, b, a };
+
+     dfdok_record_write( DFDOK_OP_CLEAR, dfdok_record_lookup( thiz ), &color, sizeof(color), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->Clear( thiz, r, g, b, a );
+}
+
+static DFBResult dfdok_record_SetColor( IDirectFBSurface *thiz, u8 r, u8 g, u8 b, u8 a )
+{
+     DFDokRecordColor color = { r, g, b, a };
+
+     dfdok_record_write( DFDOK_OP_SET_COLOR, dfdok_record_lookup( thiz ), &color, sizeof(color), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->SetColor( thiz, r, g, b, a );
+}
+
+static DFBResult dfdok_record_SetSrcColorKey( IDirectFBSurface *thiz, u8 r, u8 g, u8 b )
+{
+     DFDokRecordColor color = { r, g, b, 0 };
+
+     dfdok_record_write( DFDOK_OP_SET_SRC_COLORKEY, dfdok_record_lookup( thiz ), &color, sizeof(color), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->SetSrcColorKey( thiz, r, g, b );
+}
+
+static DFBResult dfdok_record_SetDstColorKey( IDirectFBSurface *thiz, u8 r, u8 g, u8 b )
+{
+     DFDokRecordColor color = { r, g, b, 0 };
+
+     dfdok_record_write( DFDOK_OP_SET_DST_COLORKEY, dfdok_record_lookup( thiz ), &color, sizeof(color), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->SetDstColorKey( thiz, r, g, b );
+}
+
+static DFBResult dfdok_record_SetDrawingFlags( IDirectFBSurface *thiz, DFBSurfaceDrawingFlags flags )
+{
+     u32 value = flags;
+
+     dfdok_record_write( DFDOK_OP_SET_DRAWING_FLAGS, dfdok_record_lookup( thiz ), &value, sizeof(value), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->SetDrawingFlags( thiz, flags );
+}
+
+static DFBResult dfdok_record_SetBlittingFlags( IDirectFBSurface *thiz, DFBSurfaceBlittingFlags flags )
+{
+     u32 value = flags;
+
+     dfdok_record_write( DFDOK_OP_SET_BLITTING_FLAGS, dfdok_record_lookup( thiz ), &value, sizeof(value), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->SetBlittingFlags( thiz, flags );
+}
+
+static DFBResult dfdok_record_SetPorterDuff( IDirectFBSurface *thiz, DFBSurfacePorterDuffRule rule )
+{
+     u32 value = rule;
+
+     dfdok_record_write( DFDOK_OP_SET_PORTER_DUFF, dfdok_record_lookup( thiz ), &value, sizeof(value), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->SetPorterDuff( thiz, rule );
+}
+
+static DFBResult dfdok_record_SetRenderOptions( IDirectFBSurface *thiz, DFBSurfaceRenderOptions options )
+{
+     u32 value = options;
+
+     dfdok_record_write( DFDOK_OP_SET_RENDER_OPTIONS, dfdok_record_lookup( thiz ), &value, sizeof(value), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->SetRenderOptions( thiz, options );
+}
+
+static DFBResult dfdok_record_SetSrcBlendFunction( IDirectFBSurface *thiz, DFBSurfaceBlendFunction function )
+{
+     u32 value = function;
+
+     dfdok_record_write( DFDOK_OP_SET_SRC_BLEND_FUNCTION, dfdok_record_lookup( thiz ), &value, sizeof(value), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->SetSrcBlendFunction( thiz, function );
+}
+
+static DFBResult dfdok_record_SetDstBlendFunction( IDirectFBSurface *thiz, DFBSurfaceBlendFunction function )
+{
+     u32 value = function;
+
+     dfdok_record_write( DFDOK_OP_SET_DST_BLEND_FUNCTION, dfdok_record_lookup( thiz ), &value, sizeof(value), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->SetDstBlendFunction( thiz, function );
+}
+
+static DFBResult dfdok_record_SetMatrix( IDirectFBSurface *thiz, const s32 *matrix )
+{
+     if (matrix)
+          dfdok_record_write( DFDOK_OP_SET_MATRIX, dfdok_record_lookup( thiz ), matrix, 9 * sizeof(s32), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->SetMatrix( thiz, matrix );
+}
+
+static DFBResult dfdok_record_SetSrcColorKeyIndex( IDirectFBSurface *thiz, unsigned int index )
+{
+     u32 value = index;
+
+     dfdok_record_write( DFDOK_OP_SET_SRC_COLORKEY_INDEX, dfdok_record_lookup( thiz ), &value, sizeof(value), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->SetSrcColorKeyIndex( thiz, index );
+}
+
+static DFBResult dfdok_record_SetDstColorKeyIndex( IDirectFBSurface *thiz, unsigned int index )
+{
+     u32 value = index;
+
+     dfdok_record_write( DFDOK_OP_SET_DST_COLORKEY_INDEX, dfdok_record_lookup( thiz ), &value, sizeof(value), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->SetDstColorKeyIndex( thiz, index );
+}
+
+static DFBResult dfdok_record_SetSourceMask( IDirectFBSurface *thiz, IDirectFBSurface *mask, int x, int y,
+                                            DFBSurfaceMaskFlags flags )
+{
+     DFDokRecordSourceMask source_mask;
+     int                   id = dfdok_record_lookup( thiz );
+
+     if (id >= 0) {
+          source_mask.mask  = mask ? (u32) dfdok_record_source( mask ) : 0xFFFFFFFF;
+          source_mask.x     = x;
+          source_mask.y     = y;
+          source_mask.flags = flags;
+
+          dfdok_record_write( DFDOK_OP_SET_SOURCE_MASK, id, &source_mask, sizeof(source_mask), NULL, 0 );
+     }
+
+     return DFDOK_RECORD_THIZ( thiz )->SetSourceMask( thiz, mask, x, y, flags );
+}
+
+static DFBResult dfdok_record_SetClip( IDirectFBSurface *thiz, const DFBRegion *clip )
+{
+     DFDokRecordRegion region;
+
+     memset( &region, 0, sizeof(region) );
+
+     if (clip) {
+          region.valid  = 1;
+          region.region = *clip;
+     }
+
+     dfdok_record_write( DFDOK_OP_SET_CLIP, dfdok_record_lookup( thiz ), &region, sizeof(region), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->SetClip( thiz, clip );
+}
+
+static DFBResult dfdok_record_FillRectangle( IDirectFBSurface *thiz, int x, int y, int w, int h )
+{
+     DFBRectangle rect = { x, y, w, h };
+
+     dfdok_record_write( DFDOK_OP_FILL_RECTANGLES, dfdok_record_lookup( thiz ), &rect, sizeof(rect), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->FillRectangle( thiz, x, y, w, h );
+}
+
+static DFBResult dfdok_record_FillRectangles( IDirectFBSurface *thiz, const DFBRectangle *rects, unsigned int num )
+{
+     dfdok_record_write( DFDOK_OP_FILL_RECTANGLES, dfdok_record_lookup( thiz ), rects, num * sizeof(DFBRectangle),
+                         NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->FillRectangles( thiz, rects, num );
+}
+
+static DFBResult dfdok_record_DrawRectangle( IDirectFBSurface *thiz, int x, int y, int w, int h )
+{
+     DFBRectangle rect = { x, y, w, h };
+
+     dfdok_record_write( DFDOK_OP_DRAW_RECTANGLE, dfdok_record_lookup( thiz ), &rect, sizeof(rect), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->DrawRectangle( thiz, x, y, w, h );
+}
+
+static DFBResult dfdok_record_DrawLine( IDirectFBSurface *thiz, int x1, int y1, int x2, int y2 )
+{
+     DFBRegion line = { x1, y1, x2, y2 };
+
+     dfdok_record_write( DFDOK_OP_DRAW_LINES, dfdok_record_lookup( thiz ), &line, sizeof(line), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->DrawLine( thiz, x1, y1, x2, y2 );
+}
+
+static DFBResult dfdok_record_DrawLines( IDirectFBSurface *thiz, const DFBRegion *lines, unsigned int num )
+{
+     dfdok_record_write( DFDOK_OP_DRAW_LINES, dfdok_record_lookup( thiz ), lines, num * sizeof(DFBRegion), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->DrawLines( thiz, lines, num );
+}
+
+static DFBResult dfdok_record_FillTriangle( IDirectFBSurface *thiz, int x1, int y1, int x2, int y2, int x3, int y3 )
+{
+     DFBTriangle tri = { x1, y1, x2, y2, x3, y3 };
+
+     dfdok_record_write( DFDOK_OP_FILL_TRIANGLES, dfdok_record_lookup( thiz ), &tri, sizeof(tri), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->FillTriangle( thiz, x1, y1, x2, y2, x3, y3 );
+}
+
+static DFBResult dfdok_record_FillTriangles( IDirectFBSurface *thiz, const DFBTriangle *tris, unsigned int num )
+{
+     dfdok_record_write( DFDOK_OP_FILL_TRIANGLES, dfdok_record_lookup( thiz ), tris, num * sizeof(DFBTriangle),
+                         NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->FillTriangles( thiz, tris, num );
+}
+
+static DFBResult dfdok_record_FillSpans( IDirectFBSurface *thiz, int y, const DFBSpan *spans, unsigned int num )
+{
+     s32 y32 = y;
+
+     dfdok_record_write( DFDOK_OP_FILL_SPANS, dfdok_record_lookup( thiz ), &y32, sizeof(y32),
+                         spans, num * sizeof(DFBSpan) );
+
+     return DFDOK_RECORD_THIZ( thiz )->FillSpans( thiz, y, spans, num );
+}
+
+static DFBResult dfdok_record_FillTrapezoids( IDirectFBSurface *thiz, const DFBTrapezoid *traps, unsigned int num )
+{
+     dfdok_record_write( DFDOK_OP_FILL_TRAPEZOIDS, dfdok_record_lookup( thiz ), traps, num * sizeof(DFBTrapezoid),
+                         NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->FillTrapezoids( thiz, traps, num );
+}
+
+static inline void dfdok_record_blit( DFDokRecordOp op, IDirectFBSurface *thiz, IDirectFBSurface *source,
+                                      const DFBRectangle *rect, int x, int y )
+{
+     DFDokRecordBlit blit;
+     int             id = dfdok_record_lookup( thiz );
+
+     if (id < 0)
+          return;
+
+     memset( &blit, 0, sizeof(blit) );
+
+     blit.source = dfdok_record_source( source );
+     blit.x      = x;
+     blit.y      = y;
+
+     if (rect) {
+          blit.valid = 1;
+          blit.rect  = *rect;
+     }
+
+     dfdok_record_write( op, id, &blit, sizeof(blit), NULL, 0 );
+}
+
+static DFBResult dfdok_record_Blit( IDirectFBSurface *thiz, IDirectFBSurface *source, const DFBRectangle *rect,
+                                   int x, int y )
+{
+     dfdok_record_blit( DFDOK_OP_BLIT, thiz, source, rect, x, y );
+
+     return DFDOK_RECORD_THIZ( thiz )->Blit( thiz, source, rect, x, y );
+}
+
+static DFBResult dfdok_record_TileBlit( IDirectFBSurface *thiz, IDirectFBSurface *source, const DFBRectangle *rect,
+                                       int x, int y )
+{
+     dfdok_record_blit( DFDOK_OP_TILE_BLIT, thiz, source, rect, x, y );
+
+     return DFDOK_RECORD_THIZ( thiz )->TileBlit( thiz, source, rect, x, y );
+}
+
+static DFBResult dfdok_record_StretchBlit( IDirectFBSurface *thiz, IDirectFBSurface *source,
+                                          const DFBRectangle *source_rect, const DFBRectangle *dest_rect )
+{
+     DFDokRecordStretchBlit blit;
+     int                    id = dfdok_record_lookup( thiz );
+
+     if (id >= 0) {
+          memset( &blit, 0, sizeof(blit) );
+
+          blit.source = dfdok_record_source( source );
+
+          if (source_rect) {
+               blit.valid       |= 1;
+               blit.source_rect  = *source_rect;
+          }
+
+          if (dest_rect) {
+               blit.valid     |= 2;
+               blit.dest_rect  = *dest_rect;
+          }
+
+          dfdok_record_write( DFDOK_OP_STRETCH_BLIT, id, &blit, sizeof(blit), NULL, 0 );
+     }
+
+     return DFDOK_RECORD_THIZ( thiz )->StretchBlit( thiz, source, source_rect, dest_rect );
+}
+
+static DFBResult dfdok_record_BatchBlit( IDirectFBSurface *thiz, IDirectFBSurface *source,
+                                        const DFBRectangle *source_rects, const DFBPoint *dest_points, int num )
+{
+     int id = dfdok_record_lookup( thiz );
+
+     if (id >= 0 && num > 0) {
+          u32 source_id = dfdok_record_source( source );
+
+          dfdok_record_header( DFDOK_OP_BATCH_BLIT, id,
+                               sizeof(source_id) + num * (sizeof(DFBRectangle) + sizeof(DFBPoint)) );
+
+          fwrite( &source_id, sizeof(source_id), 1, dfdok_record_file );
+          fwrite( source_rects, num * sizeof(DFBRectangle), 1, dfdok_record_file );
+          fwrite( dest_points, num * sizeof(DFBPoint), 1, dfdok_record_file );
+     }
+
+     return DFDOK_RECORD_THIZ( thiz )->BatchBlit( thiz, source, source_rects, dest_points, num );
+}
+
+static DFBResult dfdok_record_BatchStretchBlit( IDirectFBSurface *thiz, IDirectFBSurface *source,
+                                               const DFBRectangle *source_rects, const DFBRectangle *dest_rects,
+                                               int num )
+{
+     int id = dfdok_record_lookup( thiz );
+
+     if (id >= 0 && num > 0) {
+          u32 source_id = dfdok_record_source( source );
+
+          dfdok_record_header( DFDOK_OP_BATCH_STRETCH_BLIT, id, sizeof(source_id) + num * 2 * sizeof(DFBRectangle) );
+
+          fwrite( &source_id, sizeof(source_id), 1, dfdok_record_file );
+          fwrite( source_rects, num * sizeof(DFBRectangle), 1, dfdok_record_file );
+          fwrite( dest_rects, num * sizeof(DFBRectangle), 1, dfdok_record_file );
+     }
+
+     return DFDOK_RECORD_THIZ( thiz )->BatchStretchBlit( thiz, source, source_rects, dest_rects, num );
+}
+
+static DFBResult dfdok_record_Flip( IDirectFBSurface *thiz, const DFBRegion *region, DFBSurfaceFlipFlags flags )
+{
+     DFDokRecordRegion flip;
+
+     memset( &flip, 0, sizeof(flip) );
+
+     if (region) {
+          flip.valid  = 1;
+          flip.region = *region;
+     }
+
+     flip.flags = flags;
+
+     dfdok_record_write( DFDOK_OP_FLIP, dfdok_record_lookup( thiz ), &flip, sizeof(flip), NULL, 0 );
+
+     return DFDOK_RECORD_THIZ( thiz )->Flip( thiz, region, flags );
+}
+
+static DFBResult dfdok_record_GetSubSurface( IDirectFBSurface *thiz, const DFBRectangle *rect,
+                                            IDirectFBSurface **ret_interface )
+{
+     DFBResult             ret;
+     DFDokRecordSubSurface sub;
+     int                   parent = dfdok_record_lookup( thiz );
+     int                   id;
+
+     ret = DFDOK_RECORD_THIZ( thiz )->GetSubSurface( thiz, rect, ret_interface );
+     if (ret)
+          return ret;
+
+     id = dfdok_record_add( *ret_interface );
+     if (id < 0)
+          return DFB_OK;
+
+     memset( &sub, 0, sizeof(sub) );
+
+     sub.parent = parent;
+
+     if (rect)
+          sub.rect = *rect;
+     else
+          thiz->GetSize( thiz, &sub.rect.w, &sub.rect.h );
+
+     dfdok_record_write( DFDOK_OP_SUBSURFACE, id, &sub, sizeof(sub), NULL, 0 );
+
+     return DFB_OK;
+}
+
+/* register a surface with a create record and wrap its functions */
+static int dfdok_record_add( IDirectFBSurface *surface )
+{
+     DFDokRecordSurface    *entry;
+     DFDokRecordCreate      create;
+     DFBSurfacePixelFormat  format;
+     DFBSurfaceCapabilities caps;
+     int                    id = dfdok_record_lookup( surface );
+
+     if (!dfdok_record_file)
+          return -1;
+
+     if (id >= 0 && surface->Blit == dfdok_record_Blit)
+          return id;
+
+     /* new entry, also for a new interface at the address of a released one */
+     if (dfdok_record_num_surfaces >= 0xFFFF)
+          return -1;
+
+     entry = realloc( dfdok_record_surfaces, (dfdok_record_num_surfaces + 1) * sizeof(DFDokRecordSurface) );
+     if (!entry)
+          return -1;
+
+     dfdok_record_surfaces = entry;
+
+     id = dfdok_record_num_surfaces++;
+
+     entry = &dfdok_record_surfaces[id];
+
+     entry->surface  = surface;
+     entry->funcs    = *surface;
+     entry->has_data = false;
+
+     surface->GetSize( surface, &create.width, &create.height );
+     surface->GetPixelFormat( surface, &format );
+     surface->GetCapabilities( surface, &caps );
+
+     create.format = format;
+     create.caps   = caps;
+
+     if (!(caps & DSCAPS_SUBSURFACE))
+          dfdok_record_write( DFDOK_OP_CREATE, id, &create, sizeof(create), NULL, 0 );
+
+     surface->Clear               = dfdok_record_Clear;
+     surface->SetColor            = dfdok_record_SetColor;
+     surface->SetSrcColorKey      = dfdok_record_SetSrcColorKey;
+     surface->SetDstColorKey      = dfdok_record_SetDstColorKey;
+     surface->SetDrawingFlags     = dfdok_record_SetDrawingFlags;
+     surface->SetBlittingFlags    = dfdok_record_SetBlittingFlags;
+     surface->SetPorterDuff       = dfdok_record_SetPorterDuff;
+     surface->SetRenderOptions    = dfdok_record_SetRenderOptions;
+     surface->SetSrcBlendFunction = dfdok_record_SetSrcBlendFunction;
+     surface->SetDstBlendFunction = dfdok_record_SetDstBlendFunction;
+     surface->SetMatrix           = dfdok_record_SetMatrix;
+     surface->SetSrcColorKeyIndex = dfdok_record_SetSrcColorKeyIndex;
+     surface->SetDstColorKeyIndex = dfdok_record_SetDstColorKeyIndex;
+     surface->SetSourceMask       = dfdok_record_SetSourceMask;
+     surface->SetClip             = dfdok_record_SetClip;
+     surface->FillRectangle       = dfdok_record_FillRectangle;
+     surface->FillRectangles      = dfdok_record_FillRectangles;
+     surface->DrawRectangle       = dfdok_record_DrawRectangle;
+     surface->DrawLine            = dfdok_record_DrawLine;
+     surface->DrawLines           = dfdok_record_DrawLines;
+     surface->FillTriangle        = dfdok_record_FillTriangle;
+     surface->FillTriangles       = dfdok_record_FillTriangles;
+     surface->FillSpans           = dfdok_record_FillSpans;
+     surface->FillTrapezoids      = dfdok_record_FillTrapezoids;
+     surface->Blit                = dfdok_record_Blit;
+     surface->TileBlit            = dfdok_record_TileBlit;
+     surface->StretchBlit         = dfdok_record_StretchBlit;
+     surface->BatchBlit           = dfdok_record_BatchBlit;
+     surface->BatchStretchBlit    = dfdok_record_BatchStretchBlit;
+     surface->Flip                = dfdok_record_Flip;
+     surface->GetSubSurface       = dfdok_record_GetSubSurface;
+
+     return id;
+}
+
+static DFBResult dfdok_record_CreateSurface( IDirectFB *thiz, const DFBSurfaceDescription *desc,
+                                            IDirectFBSurface **ret_interface )
+{
+     DFBResult ret;
+
+     ret = dfdok_record_create( thiz, desc, ret_interface );
+     if (ret)
+          return ret;
+
+     dfdok_record_add( *ret_interface );
+
+     return DFB_OK;
+}
+
+/**********************************************************************************************************************/
+
+/* start recording all surfaces created by 'dfb' from now on */
+static inline DFBResult df_dok_record_start( IDirectFB *dfb, const char *filename )
+{
+     u32 version = DFDOK_RECORD_VERSION;
+
+     if (dfdok_record_file)
+          return DFB_BUSY;
+
+     dfdok_record_file = fopen( filename, "wb" );
+     if (!dfdok_record_file)
+          return DFB_IO;
+
+     fwrite( DFDOK_RECORD_MAGIC, 8, 1, dfdok_record_file );
+     fwrite( &version, sizeof(version), 1, dfdok_record_file );
+
+     dfdok_record_dfb    = dfb;
+     dfdok_record_create = dfb->CreateSurface;
+
+     dfb->CreateSurface = dfdok_record_CreateSurface;
+
+     return DFB_OK;
+}
+
+/* record a surface created before recording was started, e.g. the primary surface */
+static inline void df_dok_record_surface( IDirectFBSurface *surface )
+{
+     dfdok_record_add( surface );
+}
+
+/* stop recording, recorded surfaces keep forwarding to their original functions */
+static inline void df_dok_record_stop( void )
+{
+     if (!dfdok_record_file)
+          return;
+
+     dfdok_record_dfb->CreateSurface = dfdok_record_create;
+
+     fclose( dfdok_record_file );
+
+     dfdok_record_file = NULL;
+}
+
+#endif